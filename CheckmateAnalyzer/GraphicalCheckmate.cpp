@@ -100,7 +100,7 @@ void PrintMateCount()
 	for (int i = 1; i < POSITION_ARRAY_SIZE; i++)
 		positions[i] = gPieces[i - 1].GetIndex();
 
-	int mateCount = (int)gCheckmate->GetMovesToCheckmateCount(positions);
+	int mateCount = gCheckmate->GetFullMovesToCheckmateCount(positions);
 
 	if(mateCount==0)
 		cout << gPieceColorNames[(int)gTurn] << " is in Checkmate!" << endl;
@@ -269,7 +269,7 @@ void DrawLegalMoves(bool drawBestMoves)
 		positions[i] = gPieces[i - 1].GetIndex();
 
 //	unsigned char s = gCheckmate->GetStatus(positions);
-	int moveCount = (int)gCheckmate->GetMovesToCheckmateCount(positions);
+	int moveCount = gCheckmate->GetFullMovesToCheckmateCount(positions);
 	PIECE_COLOR expectedWinner = gCheckmate->GetExpectedWinner(positions);
 	LEGAL_MOVE allLegalMoves[MAX_LEGAL_MOVES];
 	int legalMoveCount = 0;
@@ -298,7 +298,7 @@ void DrawLegalMoves(bool drawBestMoves)
 		if (drawBestMoves)
 		{
 			bool isBestMove = false;
-			int x2 =  (int)gCheckmate->GetMovesToCheckmateCount(positions2);
+			int x2 =  gCheckmate->GetFullMovesToCheckmateCount(positions2);
 //			unsigned char s2 = gCheckmate->GetStatus(positions2);
 			PIECE_COLOR expectedWinner2 = gCheckmate->GetExpectedWinner(positions2);
 
@@ -0,0 +1,872 @@
+/*
+Benchmarks for choosing how to make tables.
+*/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+using namespace std;
+#include "Benchmarks.h"
+#include "BuildScheduler.h"
+#include "MemoryPlanner.h"
+
+struct SUCCESSOR_MODE_RESULT
+{
+	double seconds;
+	long long memoryBytes;
+};
+
+static SUCCESSOR_MODE_RESULT MakeTableTimed(const std::vector< PIECE_TYPES>& pieces, bool onTheFly)
+{
+	SUCCESSOR_MODE_RESULT result;
+	auto start = chrono::steady_clock::now();
+	{
+		Checkmate checkmate;
+		checkmate.SetOnTheFlySuccessors(onTheFly);
+		checkmate.Initialize(pieces, false);
+		result.memoryBytes = checkmate.GetTableMemoryBytes();
+	}
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+bool BenchmarkSuccessorModes(const std::vector<std::string>& signatures)
+{
+	vector< vector< PIECE_TYPES> > tables;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		vector< PIECE_TYPES> pieces;
+		if (!BuildScheduler::PiecesFromSignature(signatures[i], pieces))
+		{
+			cout << "Error. " << signatures[i] << " is not a set of " << NUM_PIECES << " pieces." << endl;
+			return false;
+		}
+		tables.push_back(pieces);
+	}
+
+	vector<SUCCESSOR_MODE_RESULT> cached;
+	vector<SUCCESSOR_MODE_RESULT> onTheFly;
+	for (unsigned int i = 0; i < tables.size(); i++)
+	{
+		cached.push_back(MakeTableTimed(tables[i], false));
+		onTheFly.push_back(MakeTableTimed(tables[i], true));
+	}
+
+	cout << "\nSuccessor benchmark (seconds, megabytes):" << endl;
+	cout << "table\tcached\t\ton the fly\tslowdown\tmemory saved" << endl;
+	for (unsigned int i = 0; i < tables.size(); i++)
+	{
+		double megabytes = 1024.0 * 1024.0;
+		cout << signatures[i] << "\t"
+			<< cached[i].seconds << "s " << (long long)(cached[i].memoryBytes / megabytes) << "MB\t"
+			<< onTheFly[i].seconds << "s " << (long long)(onTheFly[i].memoryBytes / megabytes) << "MB\t"
+			<< onTheFly[i].seconds / (cached[i].seconds > 0 ? cached[i].seconds : 1) << "x\t\t"
+			<< (long long)((cached[i].memoryBytes - onTheFly[i].memoryBytes) / megabytes) << "MB" << endl;
+	}
+	return true;
+}
+
+// Where the kernels put what they find, so the compiler can't leave them out.
+static volatile long long gKernelSink;
+
+struct KERNEL_RESULT
+{
+	std::string table;
+	std::string name;
+	double medianNs; // per call
+	double fastestNs;
+	double slowestNs;
+};
+
+// Times run(), which makes calls calls to the kernel. setup() runs before each repeat, untimed.
+template <typename SETUP, typename RUN>
+static KERNEL_RESULT TimeKernel(const std::string& table, const std::string& name, long long calls, SETUP setup, RUN run)
+{
+	setup();
+	run(); // warm up
+
+	// Enough runs for each repeat to be long enough to time.
+	int runs = 1;
+	while (true)
+	{
+		double seconds = 0;
+		for (int r = 0; r < runs; r++)
+		{
+			setup();
+			auto start = chrono::steady_clock::now();
+			run();
+			seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+		if (seconds >= KERNEL_MIN_SECONDS || runs >= (1 << 20))
+			break;
+		runs *= 2;
+	}
+
+	vector<double> nanoseconds;
+	for (int repeat = 0; repeat < KERNEL_REPEATS; repeat++)
+	{
+		double seconds = 0;
+		for (int r = 0; r < runs; r++)
+		{
+			setup();
+			auto start = chrono::steady_clock::now();
+			run();
+			seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+		nanoseconds.push_back(seconds * 1e9 / ((double)runs * calls));
+	}
+	sort(nanoseconds.begin(), nanoseconds.end());
+
+	KERNEL_RESULT result;
+	result.table = table;
+	result.name = name;
+	result.medianNs = nanoseconds[nanoseconds.size() / 2];
+	result.fastestNs = nanoseconds.front();
+	result.slowestNs = nanoseconds.back();
+	return result;
+}
+
+// The pieces of each kind that can move in each sample position.
+struct KERNEL_PIECE_SAMPLE
+{
+	PIECE_TYPES type; // the White one stands for both colors
+	vector<int> positions; // indices into the sample
+	vector<int> pieceIndices;
+};
+
+static PIECE_TYPES GetWhitePieceType(PIECE_TYPES type)
+{
+	if (type >= PIECE_TYPES::BLACK_KING && type < PIECE_TYPES::NONE)
+		return (PIECE_TYPES)((int)type - (int)PIECE_TYPES::BLACK_KING);
+	return type;
+}
+
+static void BenchmarkTableKernels(const std::string& signature, const std::vector< PIECE_TYPES>& pieces, vector<KERNEL_RESULT>& results)
+{
+	Checkmate checkmate;
+	checkmate.Initialize(pieces, false);
+	cout << "\nTiming the kernels of " << signature << "..." << endl;
+
+	// Every so many legal positions, the same ones every run.
+	vector<int> sample;
+	long long legalCount = 0;
+	for (int p = 0; p < checkmate.mTotalPositions; p++)
+		if (checkmate.IsLegalPosition(p))
+			legalCount++;
+	long long step = legalCount / KERNEL_SAMPLE_POSITIONS;
+	if (step < 1)
+		step = 1;
+	long long legalSeen = 0;
+	for (int p = 0; p < checkmate.mTotalPositions && (int)sample.size() < KERNEL_SAMPLE_POSITIONS; p++)
+		if (checkmate.IsLegalPosition(p) && legalSeen++ % step == 0)
+			sample.push_back(p);
+	int count = (int)sample.size();
+	vector< vector<int> > samplePositions(count, vector<int>(POSITION_ARRAY_SIZE));
+	for (int i = 0; i < count; i++)
+		checkmate.FromIndex(sample[i], &samplePositions[i][0]);
+
+	// Which pieces can move in which sample positions, by kind of piece.
+	vector<KERNEL_PIECE_SAMPLE> pieceSamples;
+	for (int pieceIndex = 0; pieceIndex < NUM_PIECES; pieceIndex++)
+	{
+		PIECE_TYPES type = GetWhitePieceType(pieces[pieceIndex]);
+		unsigned int k = 0;
+		while (k < pieceSamples.size() && pieceSamples[k].type != type)
+			k++;
+		if (k == pieceSamples.size())
+		{
+			pieceSamples.push_back(KERNEL_PIECE_SAMPLE());
+			pieceSamples[k].type = type;
+		}
+		for (int i = 0; i < count; i++)
+		{
+			const int* positions = &samplePositions[i][0];
+			if (positions[pieceIndex + 1] != DEAD_POSITION && checkmate.GetColor(pieces[pieceIndex]) == (PIECE_COLOR)positions[0])
+			{
+				pieceSamples[k].positions.push_back(i);
+				pieceSamples[k].pieceIndices.push_back(pieceIndex);
+			}
+		}
+	}
+
+	auto none = []() {};
+
+	results.push_back(TimeKernel(signature, "FromIndex", count, none, [&]()
+	{
+		long long sum = 0;
+		int positions[POSITION_ARRAY_SIZE];
+		for (int i = 0; i < count; i++)
+		{
+			checkmate.FromIndex(sample[i], positions);
+			sum += positions[NUM_PIECES];
+		}
+		gKernelSink = sum;
+	}));
+	results.push_back(TimeKernel(signature, "ToIndex", count, none, [&]()
+	{
+		long long sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += checkmate.ToIndex(&samplePositions[i][0]);
+		gKernelSink = sum;
+	}));
+	results.push_back(TimeKernel(signature, "ToReplaceIndex", count, none, [&]()
+	{
+		long long sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += checkmate.ToReplaceIndex(&samplePositions[i][0], NUM_PIECES - 1, i & 63);
+		gKernelSink = sum;
+	}));
+
+	for (unsigned int k = 0; k < pieceSamples.size(); k++)
+	{
+		const KERNEL_PIECE_SAMPLE& pieceSample = pieceSamples[k];
+		int moving = (int)pieceSample.positions.size();
+		if (moving == 0)
+			continue;
+		string typeName = gPieceTypeNames[(int)pieceSample.type];
+		if (pieceSample.type == PIECE_TYPES::WHITE_KNIGHT)
+			typeName = "Knight";
+		results.push_back(TimeKernel(signature, "GatherLegalMovesFor" + typeName, moving, none, [&]()
+		{
+			long long sum = 0;
+			LEGAL_MOVE moves[MAX_LEGAL_MOVES];
+			for (int m = 0; m < moving; m++)
+			{
+				int moveCount = 0;
+				checkmate.GatherLegalMovesForPiece(pieceSample.pieceIndices[m],
+					&samplePositions[pieceSample.positions[m]][0], moves, moveCount);
+				sum += moveCount;
+			}
+			gKernelSink = sum;
+		}));
+
+		if (pieceSample.type == PIECE_TYPES::WHITE_KING)
+			continue; // kings can't give check
+		results.push_back(TimeKernel(signature, "Is" + typeName + "AttackingEnemyKing", moving, none, [&]()
+		{
+			long long sum = 0;
+			for (int m = 0; m < moving; m++)
+			{
+				int pieceIndex = pieceSample.pieceIndices[m];
+				int p = sample[pieceSample.positions[m]];
+				PIECE_COLOR player = checkmate.GetColor(pieces[pieceIndex]);
+				bool attacking = false;
+				switch (pieceSample.type)
+				{
+				case PIECE_TYPES::WHITE_QUEEN:
+					attacking = checkmate.IsQueenAttackingEnemyKing(p, pieceIndex, player);
+					break;
+				case PIECE_TYPES::WHITE_BISHOP:
+					attacking = checkmate.IsBishopAttackingEnemyKing(p, pieceIndex, player);
+					break;
+				case PIECE_TYPES::WHITE_KNIGHT:
+					attacking = checkmate.IsKnightAttackingEnemyKing(p, pieceIndex, player);
+					break;
+				case PIECE_TYPES::WHITE_ROOK:
+					attacking = checkmate.IsRookAttackingEnemyKing(p, pieceIndex, player);
+					break;
+				case PIECE_TYPES::WHITE_PAWN:
+					attacking = checkmate.IsPawnAttackingEnemyKing(p, pieceIndex, player);
+					break;
+				default:
+					break;
+				}
+				sum += attacking;
+			}
+			gKernelSink = sum;
+		}));
+	}
+
+	results.push_back(TimeKernel(signature, "IsLegalPosition", count, none, [&]()
+	{
+		long long sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += checkmate.IsLegalPosition(sample[i]);
+		gKernelSink = sum;
+	}));
+	checkmate.SetStatusPlanes(true);
+	checkmate.UpdateStatusPlanes();
+	results.push_back(TimeKernel(signature, "IsLegalPosition (bit plane)", count, none, [&]()
+	{
+		long long sum = 0;
+		for (int i = 0; i < count; i++)
+			sum += checkmate.IsLegalPosition(sample[i]);
+		gKernelSink = sum;
+	}));
+	checkmate.SetStatusPlanes(false);
+	checkmate.UpdateStatusPlanes();
+
+	// Whole planes, per position.
+	StatusPlanes planes;
+	planes.Allocate(checkmate.mTotalPositions, 3);
+	planes.GatherStatus(0, checkmate.S, ANY_ILLEGAL);
+	planes.GatherStatus(1, checkmate.S, IN_CHECK);
+	results.push_back(TimeKernel(signature, "StatusPlanes::GatherStatus", checkmate.mTotalPositions, none, [&]()
+	{
+		planes.GatherStatus(2, checkmate.S, IN_CHECK_MATE);
+	}));
+	results.push_back(TimeKernel(signature, "StatusPlanes::Count", checkmate.mTotalPositions, none, [&]()
+	{
+		gKernelSink = planes.Count(0);
+	}));
+	results.push_back(TimeKernel(signature, "StatusPlanes::AndNot", checkmate.mTotalPositions, none, [&]()
+	{
+		planes.AndNot(2, 1, 0); // legal and in check
+	}));
+
+	// All the moves from a position, and back to it, the same sample both ways.
+	results.push_back(TimeKernel(signature, "GenerateSuccessors", count, none, [&]()
+	{
+		long long sum = 0;
+		unsigned int successors[MAX_SUCCESSORS];
+		for (int i = 0; i < count; i++)
+			sum += checkmate.GenerateSuccessors(sample[i], successors);
+		gKernelSink = sum;
+	}));
+	results.push_back(TimeKernel(signature, "GeneratePredecessors", count, none, [&]()
+	{
+		long long sum = 0;
+		unsigned int predecessors[MAX_PREDECESSORS];
+		for (int i = 0; i < count; i++)
+			sum += checkmate.GeneratePredecessors(sample[i], predecessors);
+		gKernelSink = sum;
+	}));
+
+	// Probes all over the table, like reading successors does.
+	vector<int> probes(KERNEL_SAMPLE_POSITIONS);
+	unsigned int random = 12345;
+	for (int i = 0; i < KERNEL_SAMPLE_POSITIONS; i++)
+	{
+		random = random * 1103515245 + 12345;
+		probes[i] = (int)(random % checkmate.mTotalPositions);
+	}
+	results.push_back(TimeKernel(signature, "GetMovesToCheckmateCount", KERNEL_SAMPLE_POSITIONS, none, [&]()
+	{
+		long long sum = 0;
+		for (int i = 0; i < KERNEL_SAMPLE_POSITIONS; i++)
+			sum += checkmate.GetMovesToCheckmateCount(probes[i]);
+		gKernelSink = sum;
+	}));
+	results.push_back(TimeKernel(signature, "GetStatus", KERNEL_SAMPLE_POSITIONS, none, [&]()
+	{
+		long long sum = 0;
+		for (int i = 0; i < KERNEL_SAMPLE_POSITIONS; i++)
+			sum += checkmate.GetStatus(probes[i]);
+		gKernelSink = sum;
+	}));
+
+	// One IsMateInX pass. B is put back the way it was just before that pass: every position
+	// found at x or later, or never, is UNKNOWN again. Each run starts from there.
+	vector<char> before(checkmate.B, checkmate.B + checkmate.mTotalPositions);
+	for (int p = 0; p < checkmate.mTotalPositions; p++)
+	{
+		char b = before[p];
+		if (b == UNFORCEABLE || (b != ILLEGAL && b != UNKNOWN && (b >= KERNEL_MATE_PLY || b <= -KERNEL_MATE_PLY)))
+			before[p] = UNKNOWN;
+	}
+	memcpy(checkmate.B, &before[0], checkmate.mTotalPositions);
+	int sliceEnd = (int)min((long long)KERNEL_SLICE_POSITIONS, checkmate.mTotalPositions / 2);
+	results.push_back(TimeKernel(signature, "IsMateInXRange", sliceEnd, [&]()
+	{
+		memcpy(checkmate.B, &before[0], sliceEnd);
+	}, [&]()
+	{
+		int whiteCount = 0;
+		int blackCount = 0;
+		checkmate.IsMateInXRange(KERNEL_MATE_PLY, 0, sliceEnd, whiteCount, blackCount);
+		gKernelSink = whiteCount + blackCount;
+	}));
+}
+
+bool BenchmarkKernels(const std::vector<std::string>& signatures)
+{
+	vector< vector< PIECE_TYPES> > tables;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		vector< PIECE_TYPES> pieces;
+		if (!BuildScheduler::PiecesFromSignature(signatures[i], pieces))
+		{
+			cout << "Error. " << signatures[i] << " is not a set of " << NUM_PIECES << " pieces." << endl;
+			return false;
+		}
+		tables.push_back(pieces);
+	}
+
+	vector<KERNEL_RESULT> results;
+	for (unsigned int i = 0; i < tables.size(); i++)
+		BenchmarkTableKernels(signatures[i], tables[i], results);
+
+	cout << "\nKernel benchmark (nanoseconds per call, " << KERNEL_REPEATS << " repeats):" << endl;
+	cout << left << setw(10) << "table" << setw(34) << "kernel" << right
+		<< setw(10) << "median" << setw(10) << "fastest" << setw(10) << "slowest" << setw(8) << "spread" << endl;
+	cout << fixed << setprecision(2);
+	for (unsigned int r = 0; r < results.size(); r++)
+	{
+		const KERNEL_RESULT& result = results[r];
+		cout << left << setw(10) << result.table << setw(34) << result.name << right
+			<< setw(10) << result.medianNs << setw(10) << result.fastestNs << setw(10) << result.slowestNs
+			<< setw(7) << (result.slowestNs - result.fastestNs) * 100 / result.medianNs << "%" << endl;
+	}
+	cout << defaultfloat << setprecision(6);
+	return true;
+}
+
+// One table's numbers in matrix.benchmark.txt.
+struct MATRIX_RESULT
+{
+	std::string signature;
+	double seconds;
+	long long peakResidentBytes;
+	unsigned long long combinedHash;
+	unsigned long long dtzHash;
+	vector< pair<string, double> > phaseSeconds; // by phase name, all the x's added up
+};
+
+static MATRIX_RESULT GetMatrixResult(const TABLE_BUILD& build)
+{
+	MATRIX_RESULT result;
+	result.signature = build.signature;
+	result.seconds = 0;
+	result.peakResidentBytes = build.report.mPeakResidentBytes;
+	result.combinedHash = build.combinedHash;
+	result.dtzHash = build.dtzHash;
+	for (unsigned int p = 0; p < build.report.mPhases.size(); p++)
+	{
+		const PHASE_RECORD& phase = build.report.mPhases[p];
+		result.seconds += phase.wallSeconds;
+		unsigned int i = 0;
+		while (i < result.phaseSeconds.size() && result.phaseSeconds[i].first != phase.name)
+			i++;
+		if (i == result.phaseSeconds.size())
+			result.phaseSeconds.push_back(make_pair(phase.name, 0.0));
+		result.phaseSeconds[i].second += phase.wallSeconds;
+	}
+	return result;
+}
+
+// The file has, for each table:
+//		table WQ
+//		seconds 0.676
+//		peak 31457280
+//		hashes 0a6f3c19d2b84e71 93c2e8a1f04b6d5c
+//		phase IsMateInX 0.153
+//		...
+//		end
+static bool WriteMatrixResults(const std::string& filename, const vector<MATRIX_RESULT>& results)
+{
+	ofstream fout(filename);
+	if (!fout)
+		return false;
+	for (unsigned int r = 0; r < results.size(); r++)
+	{
+		const MATRIX_RESULT& result = results[r];
+		fout << "table " << result.signature << endl;
+		fout << "seconds " << result.seconds << endl;
+		fout << "peak " << result.peakResidentBytes << endl;
+		fout << "hashes " << hex << setfill('0') << setw(16) << result.combinedHash << " " << setw(16) << result.dtzHash
+			<< dec << setfill(' ') << endl;
+		for (unsigned int p = 0; p < result.phaseSeconds.size(); p++)
+			fout << "phase " << result.phaseSeconds[p].first << " " << result.phaseSeconds[p].second << endl;
+		fout << "end" << endl;
+	}
+	return (bool)fout;
+}
+
+static bool ReadMatrixResults(const std::string& filename, vector<MATRIX_RESULT>& results)
+{
+	ifstream fin(filename);
+	if (!fin)
+		return false;
+	string key;
+	MATRIX_RESULT result;
+	while (fin >> key)
+	{
+		if (key == "table")
+		{
+			result = MATRIX_RESULT();
+			fin >> result.signature;
+		}
+		else if (key == "seconds")
+			fin >> result.seconds;
+		else if (key == "peak")
+			fin >> result.peakResidentBytes;
+		else if (key == "hashes")
+			fin >> hex >> result.combinedHash >> result.dtzHash >> dec;
+		else if (key == "phase")
+		{
+			pair<string, double> phase;
+			fin >> phase.first >> phase.second;
+			result.phaseSeconds.push_back(phase);
+		}
+		else if (key == "end")
+			results.push_back(result);
+		else
+			return false;
+		if (!fin)
+			return false;
+	}
+	return true;
+}
+
+static double GetPhaseSeconds(const MATRIX_RESULT& result, const string& name)
+{
+	for (unsigned int p = 0; p < result.phaseSeconds.size(); p++)
+		if (result.phaseSeconds[p].first == name)
+			return result.phaseSeconds[p].second;
+	return 0;
+}
+
+// Prints how much faster or slower each table is than the baseline. Returns false if any hashes differ.
+static bool CompareMatrixResults(const vector<MATRIX_RESULT>& results, const vector<MATRIX_RESULT>& baseline)
+{
+	bool same = true;
+	double megabytes = 1024.0 * 1024.0;
+	cout << "\nCompared with the baseline (now / before):" << endl;
+	cout << left << setw(10) << "table" << right << setw(12) << "seconds" << setw(12) << "before" << setw(9) << "ratio"
+		<< setw(10) << "peak MB" << setw(10) << "before" << "  tables" << endl;
+	cout << fixed << setprecision(2);
+	for (unsigned int r = 0; r < results.size(); r++)
+	{
+		const MATRIX_RESULT& result = results[r];
+		unsigned int b = 0;
+		while (b < baseline.size() && baseline[b].signature != result.signature)
+			b++;
+		if (b == baseline.size())
+		{
+			cout << left << setw(10) << result.signature << right << setw(12) << result.seconds << "  not in the baseline" << endl;
+			continue;
+		}
+		const MATRIX_RESULT& before = baseline[b];
+		bool sameHashes = result.combinedHash == before.combinedHash && result.dtzHash == before.dtzHash;
+		same = same && sameHashes;
+		cout << left << setw(10) << result.signature << right << setw(12) << result.seconds << setw(12) << before.seconds
+			<< setw(8) << result.seconds / (before.seconds > 0 ? before.seconds : 1) << "x"
+			<< setw(10) << result.peakResidentBytes / megabytes << setw(10) << before.peakResidentBytes / megabytes
+			<< (sameHashes ? "  same" : "  DIFFERENT") << endl;
+
+		for (unsigned int p = 0; p < result.phaseSeconds.size(); p++)
+		{
+			const string& name = result.phaseSeconds[p].first;
+			double now = result.phaseSeconds[p].second;
+			double then = GetPhaseSeconds(before, name);
+			if (fabs(now - then) < BENCHMARK_MATRIX_MIN_PHASE * before.seconds)
+				continue;
+			cout << "    " << left << setw(34) << name << right << setw(10) << now << setw(12) << then;
+			if (then > 0)
+				cout << setw(8) << now / then << "x";
+			cout << endl;
+		}
+	}
+	cout << defaultfloat << setprecision(6);
+	if (!same)
+		cout << "Error. Some tables are different from the baseline." << endl;
+	return same;
+}
+
+bool BenchmarkBuildMatrix(const std::string& baselineFile)
+{
+	BuildScheduler scheduler;
+	scheduler.SetForceRebuild(true);
+	scheduler.SetMaxThreads(1); // so no table's time includes another's
+	for (int m = 0; m < BENCHMARK_MATRIX_SIZE; m++)
+	{
+		string signature = gBenchmarkMatrix[m];
+		if ((int)signature.size() != 2 * (NUM_PIECES - 2))
+		{
+			cout << "Skipping " << signature << ", which needs NUM_PIECES = " << signature.size() / 2 + 2 << endl;
+			continue;
+		}
+		if (!scheduler.AddSignature(signature))
+			return false;
+	}
+	if (!scheduler.Run())
+		return false;
+
+	vector<MATRIX_RESULT> results;
+	const vector<TABLE_BUILD>& builds = scheduler.GetBuilds();
+	for (unsigned int i = 0; i < builds.size(); i++)
+		results.push_back(GetMatrixResult(builds[i]));
+
+	string filename = "..\\MakeTables\\matrix.benchmark.txt"; // next to the tables (MakeFilenameFromPieces)
+	if (!WriteMatrixResults(filename, results))
+		cout << "Error. Could not write " << filename << endl;
+
+	double megabytes = 1024.0 * 1024.0;
+	cout << "\nBuild matrix benchmark:" << endl;
+	cout << left << setw(10) << "table" << right << setw(12) << "seconds" << setw(10) << "peak MB" << "  slowest phase" << endl;
+	for (unsigned int r = 0; r < results.size(); r++)
+	{
+		const MATRIX_RESULT& result = results[r];
+		unsigned int slowest = 0;
+		for (unsigned int p = 1; p < result.phaseSeconds.size(); p++)
+			if (result.phaseSeconds[p].second > result.phaseSeconds[slowest].second)
+				slowest = p;
+		cout << left << setw(10) << result.signature << right << fixed << setprecision(2)
+			<< setw(12) << result.seconds << setw(10) << result.peakResidentBytes / megabytes << defaultfloat << setprecision(6);
+		if (!result.phaseSeconds.empty())
+			cout << "  " << result.phaseSeconds[slowest].first;
+		cout << (builds[r].requested ? "" : " (needed by another table)") << endl;
+	}
+	cout << "Saved the results to " << filename << endl;
+
+	if (baselineFile.empty())
+		return true;
+	vector<MATRIX_RESULT> baseline;
+	if (!ReadMatrixResults(baselineFile, baseline))
+	{
+		cout << "Error. Could not read the baseline " << baselineFile << endl;
+		return false;
+	}
+	return CompareMatrixResults(results, baseline);
+}
+
+struct LAYOUT_RESULT
+{
+	double seconds; // all the phases added up
+	double solverSeconds; // the solver passes, all the x's added up
+	long long solverLlcMisses; // -1 if not counted
+	long long solverDtlbMisses;
+	vector<char> table; // without footers
+	vector<char> status;
+	vector<char> dtz;
+};
+
+static bool ReadPositions(const string& filename, long long positions, vector<char>& bytes)
+{
+	ifstream fin(filename, ios::binary);
+	bytes.resize((size_t)positions);
+	return fin.read(bytes.data(), positions) ? true : false;
+}
+
+static long long AddCounter(long long total, long long counter)
+{
+	return (total < 0 || counter < 0) ? -1 : total + counter;
+}
+
+// How the solver passes go, for the benchmarks that compare ways of doing them.
+struct SOLVER_CONFIG
+{
+	INDEX_LAYOUT layout;
+	SOLVER_ORDER order;
+	bool prefetch;
+	bool statusPlanes;
+};
+
+// Makes every table again with config, and the tables they need with it too. Returns false
+// if a table could not be made or read back.
+static bool MakeTablesWithConfig(const vector<string>& signatures, const SOLVER_CONFIG& config, vector<LAYOUT_RESULT>& results)
+{
+	BuildScheduler scheduler;
+	scheduler.SetForceRebuild(true);
+	scheduler.SetMaxThreads(1); // so no table's time includes another's
+	scheduler.SetPerfCounters(true);
+	scheduler.SetIndexLayout(config.layout);
+	scheduler.SetSolverOrder(config.order);
+	scheduler.SetSolverPrefetch(config.prefetch);
+	scheduler.SetStatusPlanes(config.statusPlanes);
+	scheduler.SetLegacyTableFiles(true); // the status files are compared too
+	for (unsigned int i = 0; i < signatures.size(); i++)
+		if (!scheduler.AddSignature(signatures[i]))
+			return false;
+	if (!scheduler.Run())
+		return false;
+
+	const vector<TABLE_BUILD>& builds = scheduler.GetBuilds();
+	results.assign(signatures.size(), LAYOUT_RESULT());
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		unsigned int b = 0;
+		while (b < builds.size() && builds[b].signature != signatures[i])
+			b++;
+		if (b == builds.size())
+			return false;
+		LAYOUT_RESULT& result = results[i];
+		result.seconds = 0;
+		result.solverSeconds = 0;
+		result.solverLlcMisses = 0;
+		result.solverDtlbMisses = 0;
+		for (unsigned int p = 0; p < builds[b].report.mPhases.size(); p++)
+		{
+			const PHASE_RECORD& phase = builds[b].report.mPhases[p];
+			result.seconds += phase.wallSeconds;
+			bool solverPass = false;
+			for (int s = 0; s < 6; s++)
+				solverPass = solverPass || phase.name == gSolverPassNames[s];
+			if (!solverPass)
+				continue;
+			result.solverSeconds += phase.wallSeconds;
+			result.solverLlcMisses = AddCounter(result.solverLlcMisses, phase.counters[(int)PERF_COUNTER::LLC_MISSES]);
+			result.solverDtlbMisses = AddCounter(result.solverDtlbMisses, phase.counters[(int)PERF_COUNTER::DTLB_MISSES]);
+		}
+
+		string filename = Checkmate().MakeFilenameFromPieces(builds[b].pieces);
+		long long positions = GetTotalPositions(builds[b].pieces);
+		if (!ReadPositions(filename + ".table.bin", positions, result.table) ||
+			!ReadPositions(filename + ".status.bin", positions, result.status) ||
+			!ReadPositions(filename + ".dtz.bin", positions, result.dtz))
+		{
+			cout << "Error. Could not read the " << signatures[i] << " tables back." << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Counts the positions whose table, status or DTZ differ between the layouts, looking each
+// turn major index up in the interleaved tables.
+static long long CompareLayouts(const LAYOUT_RESULT& major, const LAYOUT_RESULT& interleaved)
+{
+	Checkmate majorIndex;
+	Checkmate interleavedIndex;
+	majorIndex.SetIndexLayout(INDEX_LAYOUT::TURN_MAJOR);
+	interleavedIndex.SetIndexLayout(INDEX_LAYOUT::TURN_INTERLEAVED);
+	long long differences = 0;
+	int positions[POSITION_ARRAY_SIZE];
+	for (unsigned int i = 0; i < major.table.size(); i++)
+	{
+		majorIndex.FromIndex(i, positions);
+		int j = interleavedIndex.ToIndex(positions);
+		if (major.table[i] != interleaved.table[j] || major.status[i] != interleaved.status[j] || major.dtz[i] != interleaved.dtz[j])
+		{
+			if (differences == 0)
+			{
+				cout << "  The first difference is at " << i << ": table " << (int)major.table[i] << " and " << (int)interleaved.table[j]
+					<< ", status " << (int)(unsigned char)major.status[i] << " and " << (int)(unsigned char)interleaved.status[j]
+					<< ", DTZ " << (int)major.dtz[i] << " and " << (int)interleaved.dtz[j] << " ";
+				majorIndex.PrintPosition(positions);
+			}
+			differences++;
+		}
+	}
+	return differences;
+}
+
+static bool ValidSignatures(const std::vector<std::string>& signatures)
+{
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		vector< PIECE_TYPES> pieces;
+		if (!BuildScheduler::PiecesFromSignature(signatures[i], pieces))
+		{
+			cout << "Error. " << signatures[i] << " is not a set of " << NUM_PIECES << " pieces." << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BenchmarkIndexLayouts(const std::vector<std::string>& signatures)
+{
+	if (!ValidSignatures(signatures))
+		return false;
+
+	// Turn major last, so the tables left on disk are the default layout.
+	vector<LAYOUT_RESULT> interleaved;
+	vector<LAYOUT_RESULT> major;
+	SOLVER_CONFIG interleavedConfig = { INDEX_LAYOUT::TURN_INTERLEAVED, SOLVER_ORDER::LINEAR, false, false };
+	SOLVER_CONFIG majorConfig = { INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::LINEAR, false, false };
+	if (!MakeTablesWithConfig(signatures, interleavedConfig, interleaved) ||
+		!MakeTablesWithConfig(signatures, majorConfig, major))
+		return false;
+
+	bool same = true;
+	vector<long long> differences;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		differences.push_back(CompareLayouts(major[i], interleaved[i]));
+		same = same && differences.back() == 0;
+	}
+
+	cout << "\nIndex layout benchmark (seconds, solver pass seconds, solver pass LLC and dTLB misses):" << endl;
+	cout << left << setw(10) << "table" << setw(18) << "layout" << right << setw(10) << "seconds" << setw(10) << "solver"
+		<< setw(14) << "LLC misses" << setw(14) << "dTLB misses" << "  same" << endl;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		for (int l = 0; l < INDEX_LAYOUT_COUNT; l++)
+		{
+			const LAYOUT_RESULT& result = (l == (int)INDEX_LAYOUT::TURN_MAJOR) ? major[i] : interleaved[i];
+			cout << left << setw(10) << signatures[i] << setw(18) << gIndexLayoutNames[l] << right << fixed << setprecision(3)
+				<< setw(10) << result.seconds << setw(10) << result.solverSeconds << defaultfloat << setprecision(6)
+				<< setw(14) << result.solverLlcMisses << setw(14) << result.solverDtlbMisses;
+			if (l == (int)INDEX_LAYOUT::TURN_INTERLEAVED)
+				cout << "  " << (differences[i] == 0 ? "yes" : to_string(differences[i]) + " positions differ");
+			cout << endl;
+		}
+		cout << "  solver passes " << major[i].solverSeconds / (interleaved[i].solverSeconds > 0 ? interleaved[i].solverSeconds : 1)
+			<< "x faster interleaved" << endl;
+	}
+	cout << "Misses are -1 where the performance counters can't be read." << endl;
+	return same;
+}
+
+// Makes the tables with each of two configs, the default second so it is left on disk, and prints
+// their times and misses, and whether their tables are the same. Returns false if they aren't.
+static bool CompareSolverConfigs(const string& title, const vector<string>& signatures,
+	const SOLVER_CONFIG configs[2], const char* const names[2])
+{
+	if (!ValidSignatures(signatures))
+		return false;
+	vector<LAYOUT_RESULT> results[2];
+	for (int c = 0; c < 2; c++)
+		if (!MakeTablesWithConfig(signatures, configs[c], results[c]))
+			return false;
+
+	bool same = true;
+	cout << "\n" << title << " benchmark (seconds, solver pass seconds, solver pass LLC and dTLB misses):" << endl;
+	cout << left << setw(10) << "table" << setw(14) << "" << right << setw(10) << "seconds" << setw(10) << "solver"
+		<< setw(14) << "LLC misses" << setw(14) << "dTLB misses" << "  same" << endl;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		const LAYOUT_RESULT& before = results[0][i];
+		const LAYOUT_RESULT& after = results[1][i];
+		bool tableSame = before.table == after.table && before.status == after.status && before.dtz == after.dtz;
+		same = same && tableSame;
+		for (int c = 0; c < 2; c++)
+		{
+			const LAYOUT_RESULT& result = results[c][i];
+			cout << left << setw(10) << signatures[i] << setw(14) << names[c] << right << fixed << setprecision(3)
+				<< setw(10) << result.seconds << setw(10) << result.solverSeconds << defaultfloat << setprecision(6)
+				<< setw(14) << result.solverLlcMisses << setw(14) << result.solverDtlbMisses;
+			if (c == 1)
+				cout << "  " << (tableSame ? "yes" : "NO");
+			cout << endl;
+		}
+		cout << "  solver passes " << before.solverSeconds / (after.solverSeconds > 0 ? after.solverSeconds : 1)
+			<< "x faster " << names[1];
+		if (before.solverLlcMisses > 0 && after.solverLlcMisses >= 0)
+			cout << ", " << (double)after.solverLlcMisses / before.solverLlcMisses << "x the LLC misses";
+		cout << endl;
+	}
+	cout << "Misses are -1 where the performance counters can't be read." << endl;
+	return same;
+}
+
+bool BenchmarkSolverOrders(const std::vector<std::string>& signatures)
+{
+	SOLVER_CONFIG configs[2] = {
+		{ INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::KING_TILED, false, false },
+		{ INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::LINEAR, false, false } };
+	const char* const names[2] = { gSolverOrderNames[1], gSolverOrderNames[0] };
+	return CompareSolverConfigs("Solver order", signatures, configs, names);
+}
+
+bool BenchmarkSolverPrefetch(const std::vector<std::string>& signatures)
+{
+	SOLVER_CONFIG configs[2] = {
+		{ INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::LINEAR, true, false },
+		{ INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::LINEAR, false, false } };
+	const char* const names[2] = { "prefetch", "no prefetch" };
+	return CompareSolverConfigs("Successor prefetch", signatures, configs, names);
+}
+
+bool BenchmarkStatusPlanes(const std::vector<std::string>& signatures)
+{
+	SOLVER_CONFIG configs[2] = {
+		{ INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::LINEAR, false, true },
+		{ INDEX_LAYOUT::TURN_MAJOR, SOLVER_ORDER::LINEAR, false, false } };
+	const char* const names[2] = { "bit plane", "status bytes" };
+	return CompareSolverConfigs("Status planes", signatures, configs, names);
+}
@@ -0,0 +1,85 @@
+#pragma once
+// Benchmarks for choosing how to make tables. Run from the command line, for example:
+//		MakeTables -benchmark=successors WBWN
+//		MakeTables -benchmark=kernels WQBR WBWN WPBP
+//		MakeTables -benchmark=layouts WQBR WPBP
+//		MakeTables -benchmark=order WQBR
+//		MakeTables -benchmark=prefetch WQBR
+//		MakeTables -benchmark=planes WQBR
+//
+// successors: makes each table twice, once with the legal moves cache and once making
+// successors on the fly (Checkmate::SetOnTheFlySuccessors), and prints the time and memory of each.
+//
+// kernels: makes each table once, then times the small routines the generator spends its time in,
+// each by itself, over the same sample of KERNEL_SAMPLE_POSITIONS legal positions every run:
+// FromIndex, ToIndex, ToReplaceIndex, GatherLegalMovesFor* and Is*AttackingEnemyKing for each kind
+// of piece in the table, IsLegalPosition with and without the illegal bit plane, GenerateSuccessors
+// and GeneratePredecessors, one IsMateInX pass (x = KERNEL_MATE_PLY) over the first
+// KERNEL_SLICE_POSITIONS positions, and random probes of B and S. Then StatusPlanes' GatherStatus,
+// Count and AndNot, over the whole table. Each kernel is warmed up, then timed KERNEL_REPEATS times,
+// and the median, fastest and slowest nanoseconds per call (per position for the whole table ones)
+// are printed.
+// Use several tables to cover every kind of piece. Run a change and the code before it on the same
+// machine, and only trust differences well beyond the spread.
+//
+// matrix: makes a fixed set of tables the way production builds do (BuildScheduler, one table
+// at a time, every table made again), and records for each its total time, the time of each kind
+// of phase, its peak resident memory and the hashes of its combined and DTZ files. The results go
+// in matrix.benchmark.txt. With -baseline=file (an earlier matrix.benchmark.txt), each number is
+// compared with the baseline, and a hash that changed means the tables changed.
+// The set is KQK, KRK, KPK, KBNK, KPKP and KQKR. Only those with NUM_PIECES pieces can be made by
+// one build of this program. Tables they need, like KQK for KPK, are made and reported too.
+//
+// layouts: makes each table, and the tables it needs, with each INDEX_LAYOUT (CheckmateGeneral.h),
+// turn interleaved first so the default is left on disk, and prints the time of each, of its solver passes, and the LLC and dTLB
+// misses of the solver passes where the performance counters can be read. Then checks that every
+// position has the same table, status and DTZ values in both, after moving it to the other index.
+//
+// order: makes each table, and the tables it needs, with each SOLVER_ORDER (CheckmateGeneral.h),
+// linear, the default, last, and prints the same numbers as layouts, and whether the tables are
+// the same.
+//
+// prefetch: the same, with and then without the solver passes' successor prefetching
+// (SOLVER_PREFETCH_DISTANCE in CheckmateGeneral.h).
+//
+// planes: the same, with IsLegalPosition reading the illegal bit plane (StatusPlanes.h) and then S.
+//
+// successors and kernels need the tables of pawns' promotions on disk already.
+
+#include <string>
+#include <vector>
+
+// Returns false if a signature is not valid.
+bool BenchmarkSuccessorModes(const std::vector<std::string>& signatures);
+
+const int KERNEL_SAMPLE_POSITIONS = 4096;
+const int KERNEL_SLICE_POSITIONS = 65536;
+const int KERNEL_MATE_PLY = 3;
+const int KERNEL_REPEATS = 9;
+const double KERNEL_MIN_SECONDS = 0.02; // each timed repeat runs the kernel at least this long
+
+// Returns false if a signature is not valid.
+bool BenchmarkKernels(const std::vector<std::string>& signatures);
+
+// KQK, KRK, KPK, KBNK, KPKP and KQKR. See BuildScheduler.h for the signatures.
+const int BENCHMARK_MATRIX_SIZE = 6;
+const char gBenchmarkMatrix[BENCHMARK_MATRIX_SIZE][9] = {
+		"WQ", "WR", "WP", "WBWN", "WPBP", "WQBR"};
+// Phases that changed less than this fraction of the table's time aren't shown.
+const double BENCHMARK_MATRIX_MIN_PHASE = 0.05;
+
+// Returns false if the tables could not be made, or if baselineFile was given and a table's
+// hashes differ from it.
+bool BenchmarkBuildMatrix(const std::string& baselineFile);
+
+// Returns false if a signature is not valid, or if the layouts' tables differ.
+bool BenchmarkIndexLayouts(const std::vector<std::string>& signatures);
+
+// Returns false if a signature is not valid, or if the orders' tables differ.
+bool BenchmarkSolverOrders(const std::vector<std::string>& signatures);
+
+// Returns false if a signature is not valid, or if the tables differ with and without prefetching.
+bool BenchmarkSolverPrefetch(const std::vector<std::string>& signatures);
+
+// Returns false if a signature is not valid, or if the tables differ with and without the plane.
+bool BenchmarkStatusPlanes(const std::vector<std::string>& signatures);
@@ -0,0 +1,90 @@
+/*
+Hashing and build manifests for skipping tables that are already up to date.
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+using namespace std;
+#include "BuildCache.h"
+
+unsigned long long HashBytes(const void* data, long long size, unsigned long long hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (long long i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+unsigned long long HashString(const std::string& s, unsigned long long hash)
+{
+	return HashBytes(s.data(), (long long)s.size(), hash);
+}
+
+bool HashFile(const std::string& filename, unsigned long long& hash)
+{
+	hash = FNV_OFFSET_BASIS;
+	ifstream fin(filename, ios::binary);
+	if (!fin)
+		return false;
+	std::vector<char> buffer(1 << 20);
+	while (fin)
+	{
+		fin.read(&buffer[0], buffer.size());
+		hash = HashBytes(&buffer[0], fin.gcount(), hash);
+	}
+	return true;
+}
+
+bool HashTableFiles(const std::string& filename, unsigned long long& combinedHash, unsigned long long& dtzHash)
+{
+	return HashFile(filename + ".combined.bin", combinedHash) &&
+		HashFile(filename + ".dtz.bin", dtzHash);
+}
+
+bool ReadBuildManifest(const std::string& filename, BUILD_MANIFEST& manifest)
+{
+	ifstream fin(filename + ".build.txt");
+	if (!fin)
+		return false;
+
+	int found = 0;
+	string key;
+	while (fin >> key)
+	{
+		if (key == "signature" && fin >> manifest.signature)
+			found |= 1;
+		else if (key == "generator" && fin >> manifest.generatorVersion)
+			found |= 2;
+		else if (key == "index" && fin >> manifest.indexScheme)
+			found |= 4;
+		else if (key == "inputs" && fin >> hex >> manifest.inputsHash >> dec)
+			found |= 8;
+		else if (key == "combined" && fin >> hex >> manifest.combinedHash >> dec)
+			found |= 16;
+		else if (key == "dtz" && fin >> hex >> manifest.dtzHash >> dec)
+			found |= 32;
+		else
+			return false;
+	}
+	return found == 63;
+}
+
+bool WriteBuildManifest(const std::string& filename, const BUILD_MANIFEST& manifest)
+{
+	ofstream fout(filename + ".build.txt");
+	if (!fout)
+		return false;
+	fout << "signature " << manifest.signature << endl;
+	fout << "generator " << manifest.generatorVersion << endl;
+	fout << "index " << manifest.indexScheme << endl;
+	fout << hex << setfill('0');
+	fout << "inputs " << setw(16) << manifest.inputsHash << endl;
+	fout << "combined " << setw(16) << manifest.combinedHash << endl;
+	fout << "dtz " << setw(16) << manifest.dtzHash << endl;
+	return (bool)fout;
+}
@@ -0,0 +1,40 @@
+#pragma once
+// Build manifests, so the BuildScheduler can skip tables whose inputs haven't changed.
+//
+// Next to WBWN.combined.bin and WBWN.dtz.bin, a successful build writes WBWN.build.txt:
+//		signature WBWN
+//		generator 1
+//		index 1
+//		inputs 5d1e0c3a9b2f7e44
+//		combined 0a6f3c19d2b84e71
+//		dtz 93c2e8a1f04b6d5c
+//
+// "inputs" hashes the piece set, NUM_PIECES, GENERATOR_VERSION, INDEX_SCHEME, and the combined and
+// DTZ hashes of every table this one loaded (pawn promotions).
+// "combined" and "dtz" hash the two output files, so a damaged or replaced file is noticed.
+// All hashes are 64 bit FNV-1a.
+
+#include <string>
+
+struct BUILD_MANIFEST
+{
+	std::string signature;
+	int generatorVersion;
+	int indexScheme;
+	unsigned long long inputsHash;
+	unsigned long long combinedHash;
+	unsigned long long dtzHash;
+};
+
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const unsigned long long FNV_PRIME = 1099511628211ULL;
+
+unsigned long long HashBytes(const void* data, long long size, unsigned long long hash = FNV_OFFSET_BASIS);
+unsigned long long HashString(const std::string& s, unsigned long long hash = FNV_OFFSET_BASIS);
+bool HashFile(const std::string& filename, unsigned long long& hash);
+
+// filename is the table name without extensions, as from MakeFilenameFromPieces.
+bool ReadBuildManifest(const std::string& filename, BUILD_MANIFEST& manifest);
+bool WriteBuildManifest(const std::string& filename, const BUILD_MANIFEST& manifest);
+// Hashes the .combined.bin and .dtz.bin files. Returns false if either is missing.
+bool HashTableFiles(const std::string& filename, unsigned long long& combinedHash, unsigned long long& dtzHash);
@@ -0,0 +1,343 @@
+/*
+Timing for every phase of making a table.
+*/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+using namespace std;
+#include "BuildReport.h"
+
+// The progress line only shows for phases longer than this, and changes this often.
+const double PROGRESS_SECONDS = 1.0;
+
+double GetWallSeconds()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double GetCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0;
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (double)(k.QuadPart + u.QuadPart) / 1e7; // 100 nanosecond units
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+long long GetResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return (long long)counters.WorkingSetSize;
+#else
+	ifstream statm("/proc/self/statm");
+	long long sizePages = 0;
+	long long residentPages = 0;
+	if (!(statm >> sizePages >> residentPages))
+		return 0;
+	return residentPages * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+BuildReport::BuildReport()
+{
+	mShowProgress = false;
+	mTotalPositions = 0;
+	mTotalSuccessors = 0;
+	mPeakResidentBytes = 0;
+	mStartWall = GetWallSeconds();
+	mStartCpu = GetCpuSeconds();
+	mOtherCpuSeconds = 0;
+	mPhaseStartCpu = 0;
+	mLastProgress = 0;
+	mInPhase = false;
+	mCountersStatus = "off";
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		mPhaseStartCounters[c] = -1;
+}
+
+bool BuildReport::SetPerfCounters(bool usePerfCounters)
+{
+	mCounters.Close();
+	mCountersStatus = "off";
+	if (!usePerfCounters)
+		return true;
+	if (!mCounters.Open())
+	{
+		mCountersStatus = string("unavailable: ") + PerfCounters::DescribeError(mCounters.mOpenError);
+		cout << "Hardware performance counters are " << mCountersStatus << ". Going on without them." << endl;
+		return false;
+	}
+	mCountersStatus = "on";
+	return true;
+}
+
+void BuildReport::Start(const std::string& signature, long long totalPositions)
+{
+	mSignature = signature;
+	mTotalPositions = totalPositions;
+	mTotalSuccessors = 0;
+	mPhases.clear();
+	mWorkerSpans.clear();
+	mPeakResidentBytes = 0;
+	mStartWall = GetWallSeconds();
+	mStartCpu = GetCpuSeconds();
+	mOtherCpuSeconds = 0;
+	mInPhase = false;
+}
+
+void BuildReport::BeginPhase(const char* name, int x)
+{
+	PHASE_RECORD phase;
+	phase.name = name;
+	phase.x = x;
+	phase.startSeconds = GetWallSeconds() - mStartWall;
+	phase.wallSeconds = 0;
+	phase.cpuSeconds = 0;
+	phase.positions = 0;
+	phase.successors = 0;
+	phase.resolved = 0;
+	phase.residentBytes = 0;
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		phase.counters[c] = -1;
+	mPhases.push_back(phase);
+	mPhaseStartCpu = GetCpuSeconds();
+	mCounters.Read(mPhaseStartCounters);
+	mLastProgress = 0;
+	mInPhase = true;
+}
+
+void BuildReport::EndPhase(long long positions, long long successors, long long resolved)
+{
+	if (!mInPhase)
+		return;
+	PHASE_RECORD& phase = mPhases.back();
+	phase.wallSeconds = GetWallSeconds() - mStartWall - phase.startSeconds;
+	phase.cpuSeconds += GetCpuSeconds() - mPhaseStartCpu;
+	phase.positions = positions;
+	phase.successors = successors;
+	phase.resolved = resolved;
+	phase.residentBytes = GetResidentBytes();
+	if (phase.residentBytes > mPeakResidentBytes)
+		mPeakResidentBytes = phase.residentBytes;
+	long long counters[PERF_COUNTER_COUNT];
+	mCounters.Read(counters);
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		if (counters[c] >= 0 && mPhaseStartCounters[c] >= 0)
+			phase.counters[c] = (phase.counters[c] < 0 ? 0 : phase.counters[c]) + counters[c] - mPhaseStartCounters[c];
+	mInPhase = false;
+
+	if (mLastProgress != 0)
+		cerr << "\r" << setw(79) << " " << "\r" << flush; // clear the progress line
+}
+
+void BuildReport::AddCpuSeconds(double seconds)
+{
+	mOtherCpuSeconds += seconds;
+	if (mInPhase)
+		mPhases.back().cpuSeconds += seconds;
+}
+
+void BuildReport::AddCounters(const long long counters[PERF_COUNTER_COUNT])
+{
+	if (!mInPhase)
+		return;
+	PHASE_RECORD& phase = mPhases.back();
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		if (counters[c] >= 0)
+			phase.counters[c] = (phase.counters[c] < 0 ? 0 : phase.counters[c]) + counters[c];
+}
+
+void BuildReport::AddWorkerSpan(int worker, double startWall, double endWall)
+{
+	if (!mInPhase)
+		return;
+	WORKER_SPAN span;
+	span.phase = (int)mPhases.size() - 1;
+	span.worker = worker;
+	span.startSeconds = startWall - mStartWall;
+	span.wallSeconds = endWall - startWall;
+	mWorkerSpans.push_back(span);
+}
+
+void BuildReport::UpdateProgress(double fraction)
+{
+	if (!mShowProgress || !mInPhase || fraction <= 0)
+		return;
+	double now = GetWallSeconds();
+	double phaseSeconds = now - mStartWall - mPhases.back().startSeconds;
+	if (phaseSeconds < PROGRESS_SECONDS || (mLastProgress != 0 && now - mLastProgress < PROGRESS_SECONDS))
+		return;
+	mLastProgress = now;
+
+	const PHASE_RECORD& phase = mPhases.back();
+	cerr << "\r" << mSignature << " " << phase.name;
+	if (phase.x >= 0)
+		cerr << " " << phase.x;
+	cerr << ": " << (int)(fraction * 100) << "%, about " << (int)(phaseSeconds * (1 - fraction) / fraction)
+		<< " s left. " << (int)(now - mStartWall) << " s so far.   " << flush;
+}
+
+// Adds the phase's hardware counters, if it has any.
+static void WriteCounters(ostream& fout, const PHASE_RECORD& phase)
+{
+	bool any = false;
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		if (phase.counters[c] < 0)
+			continue;
+		fout << (any ? ", " : ", \"counters\": { ") << "\"" << gPerfCounterNames[c] << "\": " << phase.counters[c];
+		any = true;
+	}
+	if (!any)
+		return;
+	long long cycles = phase.counters[(int)PERF_COUNTER::CYCLES];
+	long long instructions = phase.counters[(int)PERF_COUNTER::INSTRUCTIONS];
+	long long llcMisses = phase.counters[(int)PERF_COUNTER::LLC_MISSES];
+	if (cycles > 0 && instructions >= 0)
+		fout << ", \"instructionsPerCycle\": " << (double)instructions / cycles;
+	if (phase.positions > 0 && llcMisses >= 0)
+		fout << ", \"llcMissesPerPosition\": " << (double)llcMisses / phase.positions;
+	fout << " }";
+}
+
+bool BuildReport::Write(const std::string& filename)
+{
+	ofstream fout(filename);
+	if (!fout)
+		return false;
+
+	double wallSeconds = GetWallSeconds() - mStartWall;
+	double cpuSeconds = GetCpuSeconds() - mStartCpu + mOtherCpuSeconds;
+
+	fout << fixed << setprecision(6);
+	fout << "{" << endl;
+	fout << "\t\"signature\": \"" << mSignature << "\"," << endl;
+	fout << "\t\"positions\": " << mTotalPositions << "," << endl;
+	fout << "\t\"successors\": " << mTotalSuccessors << "," << endl;
+	fout << "\t\"strategy\": \"" << mStrategy << "\"," << endl;
+	fout << "\t\"wallSeconds\": " << wallSeconds << "," << endl;
+	fout << "\t\"cpuSeconds\": " << cpuSeconds << "," << endl;
+	fout << "\t\"peakResidentBytes\": " << mPeakResidentBytes << "," << endl;
+	fout << "\t\"perfCounters\": \"" << mCountersStatus << "\"," << endl;
+	fout << "\t\"phases\": [" << endl;
+	for (unsigned int i = 0; i < mPhases.size(); i++)
+	{
+		const PHASE_RECORD& phase = mPhases[i];
+		double seconds = (phase.wallSeconds > 0) ? phase.wallSeconds : 1e-9;
+		fout << "\t\t{ \"name\": \"" << phase.name << "\", \"x\": " << phase.x
+			<< ", \"startSeconds\": " << phase.startSeconds
+			<< ", \"wallSeconds\": " << phase.wallSeconds << ", \"cpuSeconds\": " << phase.cpuSeconds
+			<< ", \"positions\": " << phase.positions << ", \"successors\": " << phase.successors
+			<< ", \"resolved\": " << phase.resolved << ", \"residentBytes\": " << phase.residentBytes
+			<< ", \"positionsPerSecond\": " << phase.positions / seconds
+			<< ", \"successorsPerSecond\": " << phase.successors / seconds;
+		WriteCounters(fout, phase);
+		fout << " }"
+			<< ((i + 1 < mPhases.size()) ? "," : "") << endl;
+	}
+	fout << "\t]" << endl;
+	fout << "}" << endl;
+	return (bool)fout;
+}
+
+// The name shown on a span: "IsMateInX 3", or just the phase name.
+static string GetSpanName(const PHASE_RECORD& phase)
+{
+	if (phase.x < 0)
+		return phase.name;
+	return phase.name + " " + to_string(phase.x);
+}
+
+bool WriteTrace(const std::string& filename, std::vector<BuildReport>& reports)
+{
+	ofstream fout(filename);
+	if (!fout)
+		return false;
+
+	// Every build's times are moved to one clock, starting with the first build.
+	double origin = 0;
+	bool first = true;
+	for (unsigned int r = 0; r < reports.size(); r++)
+	{
+		if (reports[r].mPhases.empty())
+			continue;
+		if (first || reports[r].GetStartWall() < origin)
+			origin = reports[r].GetStartWall();
+		first = false;
+	}
+
+	fout << fixed << setprecision(3);
+	fout << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+	string separator = "";
+	for (unsigned int r = 0; r < reports.size(); r++)
+	{
+		BuildReport& report = reports[r];
+		if (report.mPhases.empty())
+			continue;
+		int pid = r + 1;
+		double offset = (report.GetStartWall() - origin) * 1e6; // microseconds
+
+		fout << separator << "{ \"ph\": \"M\", \"name\": \"process_name\", \"pid\": " << pid
+			<< ", \"args\": { \"name\": \"" << report.mSignature << "\" } }";
+		separator = ",\n";
+		fout << separator << "{ \"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid
+			<< ", \"tid\": 0, \"args\": { \"name\": \"Initialize\" } }";
+
+		for (unsigned int p = 0; p < report.mPhases.size(); p++)
+		{
+			const PHASE_RECORD& phase = report.mPhases[p];
+			double start = offset + phase.startSeconds * 1e6;
+			double end = start + phase.wallSeconds * 1e6;
+			fout << separator << "{ \"ph\": \"X\", \"name\": \"" << GetSpanName(phase) << "\", \"cat\": \""
+				<< (phase.x < 0 ? "phase" : "solver") << "\", \"pid\": " << pid << ", \"tid\": 0"
+				<< ", \"ts\": " << start << ", \"dur\": " << phase.wallSeconds * 1e6
+				<< ", \"args\": { \"positions\": " << phase.positions << ", \"successors\": " << phase.successors
+				<< ", \"resolved\": " << phase.resolved << ", \"cpuSeconds\": " << phase.cpuSeconds << " } }";
+			if (phase.x >= 0)
+				fout << separator << "{ \"ph\": \"C\", \"name\": \"resolved\", \"pid\": " << pid
+					<< ", \"ts\": " << end << ", \"args\": { \"positions\": " << phase.resolved << " } }";
+			if (phase.residentBytes > 0)
+				fout << separator << "{ \"ph\": \"C\", \"name\": \"resident memory\", \"pid\": " << pid
+					<< ", \"ts\": " << end << ", \"args\": { \"MB\": " << phase.residentBytes / (1024.0 * 1024.0) << " } }";
+		}
+
+		vector<bool> named;
+		for (unsigned int s = 0; s < report.mWorkerSpans.size(); s++)
+		{
+			const WORKER_SPAN& span = report.mWorkerSpans[s];
+			int tid = span.worker + 1;
+			if ((int)named.size() <= span.worker)
+				named.resize(span.worker + 1, false);
+			if (!named[span.worker])
+				fout << separator << "{ \"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid
+					<< ", \"tid\": " << tid << ", \"args\": { \"name\": \"Partition worker " << span.worker << "\" } }";
+			named[span.worker] = true;
+			fout << separator << "{ \"ph\": \"X\", \"name\": \"" << GetSpanName(report.mPhases[span.phase])
+				<< "\", \"cat\": \"worker\", \"pid\": " << pid << ", \"tid\": " << tid
+				<< ", \"ts\": " << offset + span.startSeconds * 1e6 << ", \"dur\": " << span.wallSeconds * 1e6 << " }";
+		}
+	}
+	fout << endl << "] }" << endl;
+	return (bool)fout;
+}
@@ -0,0 +1,105 @@
+#pragma once
+// Timing for every phase of making a table, so slow builds and regressions can be tracked.
+//
+// Initialize calls BeginPhase and EndPhase around each init pass, the legal moves cache, each
+// solver pass (one per x), and each save and load. Every phase records its wall and CPU time,
+// how many positions it went through and how many successors it read, and how many positions
+// it resolved. With SetShowProgress, long phases also show a progress line with a time left on
+// cerr, so it stays out of logs of cout.
+//
+// At the end of a build, Write makes <name>.report.json:
+//		{ "signature": "WBWN", "positions": 34611200, "successors": ..., "strategy": "full move cache",
+//		  "wallSeconds": 70.2, "cpuSeconds": 69.8, "peakResidentBytes": ...,
+//		  "phases": [ { "name": "IsMateInX", "x": 3, "wallSeconds": 0.61, "cpuSeconds": 0.61,
+//		                "positions": 34611200, "successors": 2101522, "resolved": 1840,
+//		                "positionsPerSecond": ..., "successorsPerSecond": ... }, ... ] }
+// x is -1 for phases that aren't solver passes.
+// CPU time includes partition workers (see PartitionedSolver.cpp).
+//
+// With SetPerfCounters, each phase also gets the hardware counters (PerfCounters.h), as
+//		"counters": { "cycles": ..., "instructions": ..., "llcMisses": ..., "dtlbMisses": ...,
+//		              "branchMisses": ..., "instructionsPerCycle": ..., "llcMissesPerPosition": ... }
+// leaving out any the processor doesn't have. Few instructions per cycle with many LLC or dTLB
+// misses means the phase waits on memory (layout, prefetching), and many instructions per cycle
+// means it is compute bound (SIMD). If no counters can be read, the report says why in
+// "perfCounters" and the build goes on.
+//
+// WriteTrace puts the reports of a whole family build in one trace event file, for chrome://tracing
+// or ui.perfetto.dev. Each table is a process, with a span for every phase and solver pass on its
+// main thread, and a span on a thread of its own for every partition worker's part of each pass.
+// Counter tracks show the positions each pass resolved and the resident memory after each phase.
+
+#include <string>
+#include <vector>
+#include "PerfCounters.h"
+
+struct PHASE_RECORD
+{
+	std::string name;
+	int x; // the solver pass's x, or -1
+	double startSeconds; // since the build started
+	double wallSeconds;
+	double cpuSeconds;
+	long long positions; // gone through
+	long long successors; // read
+	long long resolved; // found by a solver pass
+	long long counters[PERF_COUNTER_COUNT]; // -1 if not counted
+	long long residentBytes; // of the whole process, at the end of the phase
+};
+
+// A partition worker's part of a solver pass.
+struct WORKER_SPAN
+{
+	int phase; // index into mPhases
+	int worker;
+	double startSeconds; // since the build started
+	double wallSeconds;
+};
+
+class BuildReport
+{
+public:
+	BuildReport();
+
+	void Start(const std::string& signature, long long totalPositions);
+	void BeginPhase(const char* name, int x = -1);
+	void EndPhase(long long positions, long long successors = 0, long long resolved = 0);
+	void AddCpuSeconds(double seconds); // done by other processes in this phase
+	void AddCounters(const long long counters[PERF_COUNTER_COUNT]); // from other processes in this phase
+	void AddWorkerSpan(int worker, double startWall, double endWall); // GetWallSeconds() times
+	void UpdateProgress(double fraction); // how much of this phase is done, 0 to 1
+	bool Write(const std::string& filename);
+
+	void SetShowProgress(bool showProgress) { mShowProgress = showProgress; }
+	bool mShowProgress;
+	// Returns false, after saying why, if there are no counters to read.
+	bool SetPerfCounters(bool usePerfCounters);
+	bool UsesPerfCounters() { return mCounters.IsOpen(); }
+
+	std::string mSignature;
+	std::string mStrategy; // how the table was made (MemoryPlanner.h)
+	long long mTotalPositions;
+	long long mTotalSuccessors; // in the legal moves cache, or 0
+	std::vector<PHASE_RECORD> mPhases;
+	std::vector<WORKER_SPAN> mWorkerSpans;
+	long long mPeakResidentBytes; // the most at the end of any phase
+	double GetStartWall() { return mStartWall; }
+
+private:
+	double mStartWall;
+	double mStartCpu;
+	double mOtherCpuSeconds; // from AddCpuSeconds
+	double mPhaseStartCpu;
+	double mLastProgress; // wall time the progress line was last shown, or 0 if it isn't showing
+	bool mInPhase;
+	PerfCounters mCounters;
+	std::string mCountersStatus; // for the report
+	long long mPhaseStartCounters[PERF_COUNTER_COUNT];
+};
+
+double GetWallSeconds();
+double GetCpuSeconds(); // user and system time of this process
+long long GetResidentBytes(); // of this process, or 0 if it can't be read
+
+// One trace event file for all these builds. Builds with no phases (skipped tables) are left out.
+bool WriteTrace(const std::string& filename, std::vector<BuildReport>& reports);
@@ -0,0 +1,453 @@
+/*
+Makes whole families of endgame tables, in dependency order, several at a time.
+*/
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+using namespace std;
+#include "BuildScheduler.h"
+#include "BuildCache.h"
+#include "MemoryPlanner.h"
+
+// The two letter codes used in table file names, indexed by PIECE_TYPES.
+const char gPieceSignatures[(int)(PIECE_TYPES::NONE)][3] = {
+		"WK", "WQ", "WB", "WN", "WR", "WP",
+		"BK", "BQ", "BB", "BN", "BR", "BP"};
+
+BuildScheduler::BuildScheduler()
+{
+	mMemoryBudget = GetAvailableMemory();
+	mMaxThreads = (int)std::thread::hardware_concurrency();
+	if (mMaxThreads < 1)
+		mMaxThreads = 1;
+	mForceRebuild = false;
+	mPartitionWorkers = 0;
+	mOutOfCoreResidentBytes = 0;
+	mOnTheFlySuccessors = false;
+	mHugePages = HUGE_PAGES::NONE;
+	mIndexLayout = INDEX_LAYOUT::TURN_MAJOR;
+	mSolverOrder = SOLVER_ORDER::LINEAR;
+	mSolverPrefetch = false;
+	mUseStatusPlanes = false;
+	mLegacyTableFiles = false;
+	mNumaPolicy = NUMA_POLICY::NONE;
+	mShowProgress = false;
+	mUsePerfCounters = false;
+}
+
+void BuildScheduler::SetOutOfCore(const std::string& directory, long long residentBytes)
+{
+	mOutOfCoreDirectory = directory;
+	mOutOfCoreResidentBytes = residentBytes;
+	for (unsigned int b = 0; b < mBuilds.size(); b++)
+		mBuilds[b].memoryEstimate = MemoryEstimate(mBuilds[b].pieces);
+}
+
+void BuildScheduler::SetOnTheFlySuccessors(bool onTheFly)
+{
+	mOnTheFlySuccessors = onTheFly;
+	for (unsigned int b = 0; b < mBuilds.size(); b++)
+		mBuilds[b].memoryEstimate = MemoryEstimate(mBuilds[b].pieces);
+}
+
+void BuildScheduler::SetMemoryBudget(long long bytes)
+{
+	mMemoryBudget = bytes;
+	for (unsigned int b = 0; b < mBuilds.size(); b++)
+		mBuilds[b].memoryEstimate = MemoryEstimate(mBuilds[b].pieces);
+}
+
+// What one build counts against the memory budget: the peak of the strategy the MemoryPlanner
+// will pick for it, with the options chosen so far.
+long long BuildScheduler::MemoryEstimate(const std::vector< PIECE_TYPES>& pieces)
+{
+	MEMORY_PLAN_OPTIONS options;
+	options.budgetBytes = mMemoryBudget;
+	options.allowMoveCache = !mOnTheFlySuccessors;
+	options.allowOutOfCore = !mOutOfCoreDirectory.empty();
+	options.outOfCoreResidentBytes = mOutOfCoreResidentBytes;
+	return PlanTableMemory(pieces, options).peakBytes;
+}
+
+bool BuildScheduler::PiecesFromSignature(const std::string& signature, std::vector< PIECE_TYPES>& pieces)
+{
+	pieces.clear();
+	pieces.push_back(PIECE_TYPES::BLACK_KING);
+	pieces.push_back(PIECE_TYPES::WHITE_KING);
+	if (signature.size() % 2 != 0)
+		return false;
+	for (size_t i = 0; i < signature.size(); i += 2)
+	{
+		bool found = false;
+		for (int pt = 0; pt < (int)PIECE_TYPES::NONE; pt++)
+		{
+			if (pt == (int)PIECE_TYPES::WHITE_KING || pt == (int)PIECE_TYPES::BLACK_KING)
+				continue; // the kings are always there, and are not part of the signature.
+			if (signature.compare(i, 2, gPieceSignatures[pt]) == 0)
+			{
+				pieces.push_back((PIECE_TYPES)pt);
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+	return pieces.size() == NUM_PIECES;
+}
+
+std::string BuildScheduler::SignatureFromPieces(const std::vector< PIECE_TYPES>& pieces)
+{
+	string signature;
+	for (unsigned int i = 2; i < pieces.size(); i++)
+		signature += gPieceSignatures[(int)pieces[i]];
+	return signature;
+}
+
+bool BuildScheduler::AddSignature(const std::string& signature)
+{
+	std::vector< PIECE_TYPES> pieces;
+	if (!PiecesFromSignature(signature, pieces))
+	{
+		cout << "Error. \"" << signature << "\" is not a set of " << NUM_PIECES << " pieces." << endl;
+		return false;
+	}
+	AddBuild(pieces, true);
+	return true;
+}
+
+void BuildScheduler::AddAllSignatures()
+{
+	// Every non-king piece type, in PIECE_TYPES order, so each set is added once.
+	std::vector< PIECE_TYPES> others;
+	for (int pt = 0; pt < (int)PIECE_TYPES::NONE; pt++)
+		if (pt != (int)PIECE_TYPES::WHITE_KING && pt != (int)PIECE_TYPES::BLACK_KING)
+			others.push_back((PIECE_TYPES)pt);
+
+	int otherCount = NUM_PIECES - 2;
+	std::vector<int> choice(otherCount, 0);
+	while (true)
+	{
+		std::vector< PIECE_TYPES> pieces;
+		pieces.push_back(PIECE_TYPES::BLACK_KING);
+		pieces.push_back(PIECE_TYPES::WHITE_KING);
+		for (int i = 0; i < otherCount; i++)
+			pieces.push_back(others[choice[i]]);
+		AddBuild(pieces, true);
+
+		// Next non-decreasing combination:
+		int i = otherCount - 1;
+		while (i >= 0 && choice[i] == (int)others.size() - 1)
+			i--;
+		if (i < 0)
+			break;
+		choice[i]++;
+		for (int j = i + 1; j < otherCount; j++)
+			choice[j] = choice[i];
+	}
+}
+
+// Returns the index of the build, adding it if it is new.
+int BuildScheduler::AddBuild(const std::vector< PIECE_TYPES>& pieces, bool requested)
+{
+	string signature = SignatureFromPieces(pieces);
+	for (unsigned int b = 0; b < mBuilds.size(); b++)
+	{
+		if (mBuilds[b].signature == signature)
+		{
+			mBuilds[b].requested = mBuilds[b].requested || requested;
+			return b;
+		}
+	}
+
+	TABLE_BUILD build;
+	build.pieces = pieces;
+	build.signature = signature;
+	build.memoryEstimate = MemoryEstimate(pieces);
+	build.requested = requested;
+	build.started = false;
+	build.done = false;
+	build.combinedHash = 0;
+	build.dtzHash = 0;
+	mBuilds.push_back(build);
+	return (int)mBuilds.size() - 1;
+}
+
+// Called by Run, once every requested table has been added, so a table made in this run is always
+// waited for, even if an older copy of it is on disk. The builds added here get theirs too.
+void BuildScheduler::ResolveDependencies()
+{
+	for (unsigned int b = 0; b < mBuilds.size(); b++)
+	{
+		mBuilds[b].dependsOn.clear();
+		mBuilds[b].diskDependencies.clear();
+	}
+	for (unsigned int b = 0; b < mBuilds.size(); b++) // mBuilds may grow
+		AddDependencies(b);
+}
+
+// Pawn promotions load the table where the first pawn of that color has become a queen.
+// If that table isn't being made in this run and isn't already on disk, it gets made too.
+void BuildScheduler::AddDependencies(int buildIndex)
+{
+	const PIECE_TYPES fromPawn[2] = { PIECE_TYPES::WHITE_PAWN, PIECE_TYPES::BLACK_PAWN };
+	const PIECE_TYPES toQueen[2] = { PIECE_TYPES::WHITE_QUEEN, PIECE_TYPES::BLACK_QUEEN };
+
+	for (int color = 0; color < 2; color++)
+	{
+		std::vector< PIECE_TYPES> promoted = mBuilds[buildIndex].pieces;
+		bool atLeastOnePawn = false;
+		for (int pi = 2; pi < NUM_PIECES; pi++)
+		{
+			if (promoted[pi] == fromPawn[color])
+			{
+				promoted[pi] = toQueen[color];
+				atLeastOnePawn = true;
+				break; // same as AssignPawnPromotions
+			}
+		}
+		if (!atLeastOnePawn)
+			continue;
+
+		string signature = SignatureFromPieces(promoted);
+		bool alreadyAdded = false;
+		for (unsigned int b = 0; b < mBuilds.size(); b++)
+			if (mBuilds[b].signature == signature)
+				alreadyAdded = true;
+		if (!alreadyAdded && TableExistsOnDisk(promoted))
+		{
+			Checkmate checkmate;
+			mBuilds[buildIndex].diskDependencies.push_back(checkmate.MakeFilenameFromPieces(promoted));
+			continue;
+		}
+
+		int dependency = AddBuild(promoted, false); // may push_back, so index mBuilds again afterwards.
+		mBuilds[buildIndex].dependsOn.push_back(dependency);
+	}
+}
+
+bool BuildScheduler::TableExistsOnDisk(const std::vector< PIECE_TYPES>& pieces)
+{
+	Checkmate checkmate;
+	// Tables of another index layout can't be promoted to, so they are made again.
+	return checkmate.CombinedTableExists(pieces) && checkmate.ReadIndexLayout(pieces) == mIndexLayout;
+}
+
+// Kahn's algorithm. Ties are broken by the order the tables were added.
+bool BuildScheduler::TopologicalOrder(std::vector<int>& order)
+{
+	order.clear();
+	std::vector<int> remainingDependencies(mBuilds.size());
+	for (unsigned int b = 0; b < mBuilds.size(); b++)
+		remainingDependencies[b] = (int)mBuilds[b].dependsOn.size();
+
+	std::vector<bool> placed(mBuilds.size(), false);
+	while (order.size() < mBuilds.size())
+	{
+		int next = -1;
+		for (unsigned int b = 0; b < mBuilds.size(); b++)
+		{
+			if (!placed[b] && remainingDependencies[b] == 0)
+			{
+				next = b;
+				break;
+			}
+		}
+		if (next == -1)
+			return false; // a cycle. Shouldn't happen, since promotions only add queens.
+
+		placed[next] = true;
+		order.push_back(next);
+		for (unsigned int b = 0; b < mBuilds.size(); b++)
+			for (unsigned int d = 0; d < mBuilds[b].dependsOn.size(); d++)
+				if (mBuilds[b].dependsOn[d] == next)
+					remainingDependencies[b]--;
+	}
+	return true;
+}
+
+// Everything that decides the bytes of this table.
+// Tables this one depends on are done before it starts, so their hashes are known.
+int BuildScheduler::GetIndexScheme()
+{
+	Checkmate checkmate;
+	checkmate.SetIndexLayout(mIndexLayout);
+	return checkmate.GetIndexScheme();
+}
+
+unsigned long long BuildScheduler::InputsHash(int buildIndex)
+{
+	const TABLE_BUILD& build = mBuilds[buildIndex];
+	unsigned long long hash = HashString(build.signature);
+	int versions[3] = { NUM_PIECES, GENERATOR_VERSION, GetIndexScheme() };
+	hash = HashBytes(versions, sizeof(versions), hash);
+
+	for (unsigned int d = 0; d < build.dependsOn.size(); d++)
+	{
+		const TABLE_BUILD& dependency = mBuilds[build.dependsOn[d]];
+		hash = HashBytes(&dependency.combinedHash, sizeof(dependency.combinedHash), hash);
+		hash = HashBytes(&dependency.dtzHash, sizeof(dependency.dtzHash), hash);
+	}
+	for (unsigned int d = 0; d < build.diskDependencies.size(); d++)
+	{
+		unsigned long long combinedHash = 0;
+		unsigned long long dtzHash = 0;
+		HashTableFiles(build.diskDependencies[d], combinedHash, dtzHash);
+		hash = HashBytes(&combinedHash, sizeof(combinedHash), hash);
+		hash = HashBytes(&dtzHash, sizeof(dtzHash), hash);
+	}
+	return hash;
+}
+
+// Runs on a worker thread.
+void BuildScheduler::MakeOrSkip(int buildIndex)
+{
+	TABLE_BUILD& build = mBuilds[buildIndex];
+	Checkmate checkmate;
+	string filename = checkmate.MakeFilenameFromPieces(build.pieces);
+	unsigned long long inputsHash = InputsHash(buildIndex);
+
+	BUILD_MANIFEST manifest;
+	if (!mForceRebuild && ReadBuildManifest(filename, manifest) &&
+		manifest.signature == build.signature &&
+		manifest.generatorVersion == GENERATOR_VERSION &&
+		manifest.indexScheme == GetIndexScheme() &&
+		manifest.inputsHash == inputsHash)
+	{
+		unsigned long long combinedHash = 0;
+		unsigned long long dtzHash = 0;
+		if (HashTableFiles(filename, combinedHash, dtzHash) &&
+			combinedHash == manifest.combinedHash && dtzHash == manifest.dtzHash &&
+			(!mLegacyTableFiles || ifstream(filename + ".table.bin")))
+		{
+			cout << build.signature << " is up to date. Skipping it." << endl;
+			build.combinedHash = combinedHash;
+			build.dtzHash = dtzHash;
+			return;
+		}
+	}
+
+	checkmate.SetMemoryBudget(mMemoryBudget);
+	checkmate.SetPartitionWorkers(mPartitionWorkers);
+	if (!mOutOfCoreDirectory.empty())
+		checkmate.SetOutOfCore(mOutOfCoreDirectory, mOutOfCoreResidentBytes);
+	checkmate.SetOnTheFlySuccessors(mOnTheFlySuccessors);
+	checkmate.SetHugePages(mHugePages);
+	checkmate.SetIndexLayout(mIndexLayout);
+	checkmate.SetSolverOrder(mSolverOrder);
+	checkmate.SetSolverPrefetch(mSolverPrefetch);
+	checkmate.SetStatusPlanes(mUseStatusPlanes);
+	checkmate.SetLegacyTableFiles(mLegacyTableFiles);
+	checkmate.SetNumaPolicy(mNumaPolicy);
+	checkmate.SetShowProgress(mShowProgress);
+	checkmate.SetPerfCounters(mUsePerfCounters);
+	checkmate.Initialize(build.pieces, false);
+	build.report = checkmate.mReport;
+
+	manifest.signature = build.signature;
+	manifest.generatorVersion = GENERATOR_VERSION;
+	manifest.indexScheme = checkmate.GetIndexScheme();
+	manifest.inputsHash = inputsHash;
+	if (!HashTableFiles(filename, manifest.combinedHash, manifest.dtzHash) ||
+		!WriteBuildManifest(filename, manifest))
+	{
+		cout << "Error. Could not write the build manifest for " << build.signature << endl;
+		return;
+	}
+	build.combinedHash = manifest.combinedHash;
+	build.dtzHash = manifest.dtzHash;
+}
+
+bool BuildScheduler::Run()
+{
+	ResolveDependencies();
+	std::vector<int> order;
+	if (!TopologicalOrder(order))
+	{
+		cout << "Error. The table dependencies have a cycle." << endl;
+		return false;
+	}
+
+	cout << "Build order for " << order.size() << " tables:" << endl;
+	for (unsigned int i = 0; i < order.size(); i++)
+	{
+		const TABLE_BUILD& build = mBuilds[order[i]];
+		cout << "  " << build.signature << " (" << build.memoryEstimate / (1024 * 1024) << " MB)";
+		if (!build.requested)
+			cout << " needed by another table";
+		for (unsigned int d = 0; d < build.dependsOn.size(); d++)
+			cout << (d == 0 ? " after " : ", ") << mBuilds[build.dependsOn[d]].signature;
+		cout << endl;
+	}
+	cout << "Memory budget is " << mMemoryBudget / (1024 * 1024) << " MB, with up to " << mMaxThreads << " tables at a time." << endl;
+
+	std::mutex lock;
+	std::condition_variable buildFinished;
+	std::vector<std::thread> threads;
+	long long memoryInUse = 0;
+	int running = 0;
+	unsigned int doneCount = 0;
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (doneCount < order.size())
+	{
+		// Start every ready table that fits, in build order.
+		for (unsigned int i = 0; i < order.size() && running < mMaxThreads; i++)
+		{
+			TABLE_BUILD& build = mBuilds[order[i]];
+			if (build.started)
+				continue;
+			bool ready = true;
+			for (unsigned int d = 0; d < build.dependsOn.size(); d++)
+				if (!mBuilds[build.dependsOn[d]].done)
+					ready = false;
+			if (!ready)
+				continue;
+			if (running > 0 && memoryInUse + build.memoryEstimate > mMemoryBudget)
+				continue; // wait for something to finish. A table that is too big by itself still runs alone.
+			if (build.memoryEstimate > mMemoryBudget)
+				cout << "Warning. " << build.signature << " needs more than the memory budget. Making it by itself." << endl;
+
+			build.started = true;
+			memoryInUse += build.memoryEstimate;
+			running++;
+			cout << "Starting " << build.signature << "..." << endl;
+
+			int buildIndex = order[i];
+			threads.push_back(std::thread([this, buildIndex, &lock, &buildFinished, &memoryInUse, &running, &doneCount]()
+			{
+				MakeOrSkip(buildIndex);
+
+				std::lock_guard<std::mutex> finished(lock);
+				mBuilds[buildIndex].done = true;
+				memoryInUse -= mBuilds[buildIndex].memoryEstimate;
+				running--;
+				doneCount++;
+				cout << "Finished " << mBuilds[buildIndex].signature << "." << endl;
+				buildFinished.notify_one();
+			}));
+		}
+		if (doneCount < order.size())
+			buildFinished.wait(guard);
+	}
+	guard.unlock();
+
+	for (unsigned int t = 0; t < threads.size(); t++)
+		threads[t].join();
+	cout << "Made all " << order.size() << " tables." << endl;
+
+	if (!mTraceFile.empty())
+	{
+		std::vector<BuildReport> reports;
+		for (unsigned int i = 0; i < order.size(); i++)
+			reports.push_back(mBuilds[order[i]].report);
+		if (WriteTrace(mTraceFile, reports))
+			cout << "Wrote the build trace to " << mTraceFile << endl;
+		else
+			cout << "Error. Could not write the build trace to " << mTraceFile << endl;
+	}
+	return true;
+}
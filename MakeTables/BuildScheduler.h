@@ -0,0 +1,115 @@
+#pragma once
+// The BuildScheduler makes whole families of tables in one run.
+//
+// Each table is named by its material signature, which is the same string MakeFilenameFromPieces
+// uses for the file name, without the two kings. For example "WBWN" is King, Bishop and Knight versus King.
+//
+// Some tables need other tables to already exist on disk:
+//		A White Pawn table loads the table where that pawn has become a White Queen (AssignPawnPromotions).
+//		A Black Pawn table likewise loads the Black Queen table.
+// Captures don't need other tables yet, because a captured piece stays in the same table at DEAD_POSITION.
+//
+// When it runs, the scheduler adds any missing dependencies, sorts everything so a table is only
+// made after the tables it needs, and then makes independent tables at the same time on separate
+// threads, as long as the estimated memory of all running builds stays within the memory budget.
+//
+// A table is skipped when its build manifest (see BuildCache.h) shows the same inputs, and its
+// output files still hash to what the manifest recorded.
+
+#include <string>
+#include <vector>
+#include "CheckmateGeneral.h"
+
+struct TABLE_BUILD
+{
+	std::vector< PIECE_TYPES> pieces; // BLACK_KING, WHITE_KING, then the others.
+	std::string signature; // "WBWN", etc.
+	std::vector<int> dependsOn; // indices into mBuilds
+	std::vector<std::string> diskDependencies; // filenames of needed tables that were already made
+	long long memoryEstimate; // bytes needed while this table is being made
+	bool requested; // false if only added because another table needs it
+	bool started;
+	bool done;
+	unsigned long long combinedHash; // of the output files, once done
+	unsigned long long dtzHash;
+	BuildReport report; // how the table was made. No phases if it was skipped.
+};
+
+class BuildScheduler
+{
+public:
+	BuildScheduler();
+
+	// signature is like "WBWN". Returns false if it is not a valid set of NUM_PIECES pieces.
+	bool AddSignature(const std::string& signature);
+	// Adds every set of NUM_PIECES pieces. NUM_PIECES is fixed at compile time, so 3 and 4 piece
+	// families are made by separate builds of this program.
+	void AddAllSignatures();
+
+	// Defaults to all the memory there is (GetAvailableMemory). Each table is made with the fastest
+	// strategy that fits in it (see MemoryPlanner.h).
+	void SetMemoryBudget(long long bytes);
+	void SetMaxThreads(int threads) { mMaxThreads = threads < 1 ? 1 : threads; }
+	void SetForceRebuild(bool forceRebuild) { mForceRebuild = forceRebuild; }
+	// Solver worker processes for each table. See Checkmate::SetPartitionWorkers.
+	void SetPartitionWorkers(int workers) { mPartitionWorkers = workers; }
+	// Lets tables that don't fit in memory be made out-of-core. See Checkmate::SetOutOfCore.
+	void SetOutOfCore(const std::string& directory, long long residentBytes);
+	// No legal moves cache. See Checkmate::SetOnTheFlySuccessors.
+	void SetOnTheFlySuccessors(bool onTheFly);
+	// See Checkmate::SetHugePages and SetNumaPolicy.
+	void SetHugePages(HUGE_PAGES hugePages) { mHugePages = hugePages; }
+	void SetNumaPolicy(NUMA_POLICY numaPolicy) { mNumaPolicy = numaPolicy; }
+	// See INDEX_LAYOUT. Tables on disk with another layout are made again.
+	void SetIndexLayout(INDEX_LAYOUT layout) { mIndexLayout = layout; }
+	void SetSolverOrder(SOLVER_ORDER order) { mSolverOrder = order; }
+	void SetSolverPrefetch(bool prefetch) { mSolverPrefetch = prefetch; }
+	void SetStatusPlanes(bool useStatusPlanes) { mUseStatusPlanes = useStatusPlanes; }
+	// Saves the .table.bin and .status.bin files too. See Checkmate::SetLegacyTableFiles.
+	void SetLegacyTableFiles(bool legacyTableFiles) { mLegacyTableFiles = legacyTableFiles; }
+	// A progress line with the time left on cerr during long phases. See BuildReport.h.
+	void SetShowProgress(bool showProgress) { mShowProgress = showProgress; }
+	// Hardware counters in each table's report. See Checkmate::SetPerfCounters.
+	void SetPerfCounters(bool usePerfCounters) { mUsePerfCounters = usePerfCounters; }
+	// At the end of Run, writes one trace of every table made. See WriteTrace in BuildReport.h.
+	void SetTraceFile(const std::string& filename) { mTraceFile = filename; }
+
+	// Makes all the added tables. Returns false if the dependencies could not be ordered.
+	bool Run();
+
+	// After Run, what was made, with each table's report and hashes.
+	const std::vector<TABLE_BUILD>& GetBuilds() { return mBuilds; }
+
+	static bool PiecesFromSignature(const std::string& signature, std::vector< PIECE_TYPES>& pieces);
+	static std::string SignatureFromPieces(const std::vector< PIECE_TYPES>& pieces);
+
+private:
+	int AddBuild(const std::vector< PIECE_TYPES>& pieces, bool requested);
+	void ResolveDependencies();
+	void AddDependencies(int buildIndex);
+	bool TopologicalOrder(std::vector<int>& order);
+	bool TableExistsOnDisk(const std::vector< PIECE_TYPES>& pieces);
+	unsigned long long InputsHash(int buildIndex);
+	int GetIndexScheme(); // of mIndexLayout
+	void MakeOrSkip(int buildIndex);
+	long long MemoryEstimate(const std::vector< PIECE_TYPES>& pieces);
+
+	std::vector<TABLE_BUILD> mBuilds;
+	long long mMemoryBudget; // bytes
+	int mMaxThreads;
+	bool mForceRebuild; // ignore the build manifests
+	int mPartitionWorkers;
+	std::string mOutOfCoreDirectory;
+	long long mOutOfCoreResidentBytes;
+	bool mOnTheFlySuccessors;
+	HUGE_PAGES mHugePages;
+	NUMA_POLICY mNumaPolicy;
+	INDEX_LAYOUT mIndexLayout;
+	SOLVER_ORDER mSolverOrder;
+	bool mSolverPrefetch;
+	bool mUseStatusPlanes;
+	bool mLegacyTableFiles;
+	bool mShowProgress;
+	bool mUsePerfCounters;
+	std::string mTraceFile; // or empty
+};
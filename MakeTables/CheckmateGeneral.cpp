@@ -11,8 +11,14 @@ More in August, 2020
 #include <assert.h>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CHECKMATE_SSE
+#include <xmmintrin.h>
+#endif
 using namespace std;
 #include "CheckmateGeneral.h"
+#include "MemoryPlanner.h"
 
 int min(int x, int y)
 {
@@ -97,7 +103,40 @@ Checkmate::Checkmate()
 	mLegalMoves2 = NULL;
 	B = NULL;
 	S = NULL;
+	Z = NULL;
 	mTotalPositions = 0;
+	mPartitionWorkers = 0;
+	mTableMemory = TABLE_MEMORY::HEAP;
+	mMoveCacheMemory = TABLE_MEMORY::HEAP;
+	mOutOfCoreBlockPositions = 0;
+	mOnTheFlySuccessors = false;
+	mHugePages = HUGE_PAGES::NONE;
+	mNumaPolicy = NUMA_POLICY::NONE;
+	mMemoryBudget = 0;
+	mPlannedMoveCacheEntries = 0;
+	mOutOfCoreResidentBytes = 0;
+	mSuccessorsVisited = 0;
+	mStatsThreads = 0;
+	mStatsFormat = STATS_FORMAT::JSON;
+	mHaveStats = false;
+	mLegacyTableFiles = false;
+	mIndexLayout = INDEX_LAYOUT::TURN_MAJOR;
+	mSolverTurn = 0;
+	mSolverOrder = SOLVER_ORDER::LINEAR;
+	mSolverPrefetch = false;
+	mUseStatusPlanes = false;
+	mStatusPlanesReady = false;
+}
+
+void Checkmate::SetOutOfCore(const std::string& directory, long long residentBytes)
+{
+	mOutOfCoreDirectory = directory;
+	mOutOfCoreResidentBytes = residentBytes;
+	// Half the resident budget goes to the block of the legal moves cache being solved, leaving
+	// the rest as headroom. B, S and Z aren't counted in it (see SetOutOfCore in CheckmateGeneral.h).
+	mOutOfCoreBlockPositions = residentBytes / 2 / OUT_OF_CORE_BYTES_PER_POSITION;
+	if (mOutOfCoreBlockPositions < KING_SQUARES)
+		mOutOfCoreBlockPositions = KING_SQUARES;
 }
 
 void Checkmate::Initialize(const std::vector< PIECE_TYPES> & pieces, bool loadData, bool printEvaluation)
@@ -107,12 +146,33 @@ void Checkmate::Initialize(const std::vector< PIECE_TYPES> & pieces, bool loadDa
 	Assert(pieces[0] == PIECE_TYPES::BLACK_KING && pieces[1] == PIECE_TYPES::WHITE_KING, "p0==BLACK_KING && p1==WHITE_KING");
 	Assert(NUM_PIECES == pieces.size(), "NUM_PIECES == pieces.size(). Update NUM_PIECES!");
 	mPieces = pieces;
-
+	mReport.Start(GetSignature(), GetTotalPositions(mPieces));
+	mSuccessorsVisited = 0;
+	mHaveStats = false;
+	mStatusPlanesReady = false;
+	mStatusPlanes.Free(); // the last table's, which may have another size
+
+	if (!loadData)
+		ChooseGenerationStrategy();
+	mReport.BeginPhase("AllocateMemory");
 	AllocateMemory(loadData, printEvaluation);
+	mReport.EndPhase(0);
 
 	if (loadData)
 	{
-		if (LoadTable1(printEvaluation, mPieces, B, S)) // Table was pre-made, and is now ready to go!
+		// Table was pre-made, and is now ready to go!
+		mIndexLayout = ReadIndexLayout(mPieces);
+		mReport.BeginPhase("LoadTable1");
+		bool loaded = (S == NULL && LoadCombinedTable(mPieces, B)) || LoadTable1(printEvaluation, mPieces, B, S);
+		if (loaded)
+		{
+			if (Z != NULL)
+				LoadDtzTable(mPieces, Z);
+			LoadOverflows(mPieces, mBOverflow, mZOverflow);
+			UpdateStatusPlanes();
+		}
+		mReport.EndPhase(mTotalPositions);
+		if (loaded)
 		{
 //			CacheAllLegalMovesForAllPositions();
 			if(printEvaluation)
@@ -132,28 +192,70 @@ void Checkmate::Initialize(const std::vector< PIECE_TYPES> & pieces, bool loadDa
     cout << "Starting..." << endl;
 
 	// Initialize graph vertices:
+	mReport.BeginPhase("InitBoardB");
 	InitBoardB();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitAllStatusBitsS");
 	InitAllStatusBitsS();
+	mReport.EndPhase(mTotalPositions);
 
 	cout << "Checking From and To conversions:" << endl;
+	mReport.BeginPhase("CheckFromAndTo");
 	CheckFromAndTo();
+	mReport.EndPhase(mTotalPositions);
 
 	cout << "Find the three kinds of illegal board configurations:" << endl;
+	mReport.BeginPhase("InitAdjacentKings");
     InitAdjacentKings();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitOnTop");
 	InitOnTop();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitBadPawns");
 	InitBadPawns();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitCheckAndBadCheck");
 	InitCheckAndBadCheck();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitStatusPlanes");
+	UpdateStatusPlanes(); // the illegal bits are all set now
+	mReport.EndPhase(mTotalPositions);
 
 	// Initialize graph edges:
-	CacheAllLegalMovesForAllPositions(); // for speed. But costs a lot of memory.
+	if (mOnTheFlySuccessors)
+		cout << "\nNo legal moves cache. Successors are made as they are needed." << endl;
+	else
+	{
+		mReport.BeginPhase("CacheAllLegalMovesForAllPositions");
+		CacheAllLegalMovesForAllPositions(); // for speed. But costs a lot of memory.
+		mReport.mTotalSuccessors = mLegalMovesRawMemoryIndex;
+		mReport.EndPhase(mTotalPositions, mReport.mTotalSuccessors);
+	}
+	if (mHugePages != HUGE_PAGES::NONE)
+		ReportPageSizes();
 
 
+	mReport.BeginPhase("InitInsufficientMaterial");
 	InitInsufficientMaterial();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitIsStalemate");
 	InitIsStalemate();
+	mReport.EndPhase(mTotalPositions);
+	mReport.BeginPhase("InitIsCheckmate");
 	InitIsCheckmate();
+	mReport.EndPhase(mTotalPositions);
 
+	mReport.BeginPhase("AssignPawnPromotions");
+	// Promotions take the promoted table's illegal bits too, and the black pawn's promotions
+	// have to see the ones the white pawn's took.
 	AssignPawnPromotions(PIECE_TYPES::WHITE_PAWN, PIECE_TYPES::WHITE_QUEEN, 7);
+	UpdateStatusPlanes();
 	AssignPawnPromotions(PIECE_TYPES::BLACK_PAWN, PIECE_TYPES::BLACK_QUEEN, 0);
+	UpdateStatusPlanes();
+	mReport.EndPhase(mTotalPositions);
+
+	if (mPartitionWorkers > 1)
+		StartPartitionWorkers();
 
 	// Find "Mate In X" positions:
 	cout << endl;
@@ -183,17 +285,73 @@ void Checkmate::Initialize(const std::vector< PIECE_TYPES> & pieces, bool loadDa
 		moves++;
 	}
 
+	// Find "Zeroing In X" positions, for the fifty move rule.
+	// Uses the same legal moves cache, and B and S from above to know who wins.
+	cout << "\nFinding the moves to a capture, pawn move or checkmate:" << endl;
+	IsResponseZeroingInX(0);
+	moves=1;
+	while(true)
+	{
+		int count = IsZeroingInX(moves);
+		if(count==0)
+			break;
+		count = IsResponseZeroingInX(moves);
+		if(count==0)
+			break;
+		moves++;
+	}
+	ReportFiftyMoveRule();
+
+	StopPartitionWorkers();
+
+	mReport.BeginPhase("SwitchMovecountValues");
 	SwitchMovecountValues();
+	mReport.EndPhase(mTotalPositions);
 
 	if(printEvaluation)
 		PrintEvaluation();
 
-	SaveTable1(mPieces);
+	mReport.BeginPhase("SaveTable1");
+	if (mLegacyTableFiles)
+		SaveTable1(mPieces);
+	SaveCombinedTable(mPieces);
+	SaveDtzTable(mPieces);
+	SaveOverflows(mPieces);
+	mReport.EndPhase(mTotalPositions);
+
+	string reportFilename = MakeFilenameFromPieces(mPieces) + ".report.json";
+	if (!mReport.Write(reportFilename))
+		cout << "Unable to write " << reportFilename << endl;
 
 	time_t t2 = time(0);
 	cout << "Total Initialize time in seconds is: " << (double)(t2 - t1) << endl;
 }
 
+// Picks the fastest way of making this table that fits in mMemoryBudget, and sets up for it.
+void Checkmate::ChooseGenerationStrategy()
+{
+	MEMORY_PLAN_OPTIONS options;
+	options.budgetBytes = mMemoryBudget ? mMemoryBudget : GetAvailableMemory();
+	options.allowMoveCache = !mOnTheFlySuccessors;
+	options.allowOutOfCore = !mOutOfCoreDirectory.empty();
+	options.outOfCoreResidentBytes = mOutOfCoreResidentBytes;
+	MEMORY_PLAN plan = PlanTableMemory(mPieces, options);
+
+	PrintMemoryPlan(GetSignature(), plan, options.budgetBytes);
+	Assert(plan.fits || plan.strategy == GENERATION_STRATEGY::OUT_OF_CORE,
+		"There is not enough memory to make this table. Use out-of-core generation (SetOutOfCore).");
+
+	mPlannedMoveCacheEntries = plan.moveCacheEntries;
+	mReport.mStrategy = gGenerationStrategyNames[(int)plan.strategy];
+	if (plan.strategy == GENERATION_STRATEGY::NO_MOVE_CACHE)
+		mOnTheFlySuccessors = true;
+	if (plan.strategy != GENERATION_STRATEGY::OUT_OF_CORE)
+	{
+		mOutOfCoreDirectory.clear();
+		mOutOfCoreBlockPositions = 0;
+	}
+}
+
 void Checkmate::AllocateMemory(bool loadData, bool printEvaluation)
 {
 	mLegalMovesRawMemory = NULL;
@@ -201,69 +359,156 @@ void Checkmate::AllocateMemory(bool loadData, bool printEvaluation)
 	mLegalMoves2 = NULL;
 	B = NULL;
 	S = NULL;
+	Z = NULL;
 
 	// The table isn't pre-made, so we have to make it.
 	//const int TOTAL_POSITIONS = 2 * KING_SQUARES * KING_SQUARES * OTHER_SQUARES * OTHER_SQUARES;
 	mTotalPositions = 2 * KING_SQUARES * KING_SQUARES;
 	for (unsigned int i = 2; i < mPieces.size(); i++)
 		mTotalPositions *= OTHER_SQUARES;
-	mLegalMovesRawMemoryRequested = mTotalPositions * (long long)10;
+	mLegalMovesRawMemoryRequested = mPlannedMoveCacheEntries ? mPlannedMoveCacheEntries : mTotalPositions * (long long)10;
+	if (!mOutOfCoreDirectory.empty() && !loadData)
+	{
+		mTableMemory = TABLE_MEMORY::FILE_BACKED;
+		mMoveCacheMemory = TABLE_MEMORY::FILE_BACKED;
+		cout << "Out-of-core generation in " << mOutOfCoreDirectory << ", " << mOutOfCoreBlockPositions << " positions per block." << endl;
+	}
+	else
+	{
+		mTableMemory = (mPartitionWorkers > 1 && !loadData) ? TABLE_MEMORY::SHARED : TABLE_MEMORY::HEAP;
+		mMoveCacheMemory = TABLE_MEMORY::HEAP;
+	}
 
-	try
+	// If we are loading the data, we only need the B array.
+	if (!loadData && !mOnTheFlySuccessors)
 	{
-		// If we are loading the data, we only need the B array.
-		if (!loadData)
-		{
-			std::cout << "Trying to get " << mLegalMovesRawMemoryRequested << " unsigned ints of RAW_MEMORY for mLegalMovesRawMemory..." << endl;
-			mLegalMovesRawMemory = new unsigned int[mLegalMovesRawMemoryRequested]; // *29 = 4,014,899,200 bytes
-			std::cout << "Got the memory!" << endl;
+		std::cout << "Trying to get " << mLegalMovesRawMemoryRequested << " unsigned ints of RAW_MEMORY for mLegalMovesRawMemory..." << endl;
+		mLegalMovesRawMemory = (unsigned int*)AllocateArray("mLegalMovesRawMemory", mLegalMovesRawMemoryRequested * sizeof(unsigned int), mMoveCacheMemory); // *29 = 4,014,899,200 bytes
+		std::cout << "Got the memory!" << endl;
 
-			std::cout << "Trying to get " << mTotalPositions + 1 << " long longs of RAW_MEMORY for mLegalMoves2..." << endl;
-			mLegalMoves2 = new long long[mTotalPositions + 1];
-			std::cout << "Got the memory!" << endl;
-		}
-		if (!loadData || printEvaluation)
-		{
-			std::cout << "Trying to get " << mTotalPositions << " bytes of RAW_MEMORY for S..." << endl;
-			S = new unsigned char[mTotalPositions];
-			std::cout << "Got the memory!" << endl;
-		}
+		std::cout << "Trying to get " << mTotalPositions + 1 << " long longs of RAW_MEMORY for mLegalMoves2..." << endl;
+		mLegalMoves2 = (long long*)AllocateArray("mLegalMoves2", (mTotalPositions + 1) * sizeof(long long), mMoveCacheMemory);
+		std::cout << "Got the memory!" << endl;
+	}
+	// The combined table has what PrintEvaluation needs from S.
+	if (!loadData || (printEvaluation && !CombinedTableExists(mPieces)))
+	{
+		std::cout << "Trying to get " << mTotalPositions << " bytes of RAW_MEMORY for S..." << endl;
+		S = (unsigned char*)AllocateArray("S", mTotalPositions, mTableMemory);
+		std::cout << "Got the memory!" << endl;
+	}
+
+	std::cout << "Trying to get " << mTotalPositions << " bytes of RAW_MEMORY for B..." << endl;
+	B = (char*)AllocateArray("B", mTotalPositions, mTableMemory);
+	std::cout << "Got the memory!" << endl;
 
-		std::cout << "Trying to get " << mTotalPositions << " bytes of RAW_MEMORY for B..." << endl;
-		B = new char[mTotalPositions];
+	// Older tables have no DTZ file.
+	if (!loadData || DtzTableExists(mPieces))
+	{
+		std::cout << "Trying to get " << mTotalPositions << " bytes of RAW_MEMORY for Z..." << endl;
+		Z = (char*)AllocateArray("Z", mTotalPositions, mTableMemory);
 		std::cout << "Got the memory!" << endl;
 	}
-	catch (int e)
-	{
-		std::cout << "An exception occurred. Exception getting initial memory. " << e << '\n';
-		if (mLegalMovesRawMemory)
-			delete[] mLegalMovesRawMemory;
-		if (B)
-			delete[] B;
-		if (S)
-			delete[] S;
-		if (mLegalMoves2)
-			delete[] mLegalMoves2;
-		system("pause");
-		system("exit");
+
+	if (!loadData)
+	{
+		// Small, so it stays in memory even out-of-core. Shared if partition workers add to it.
+		TABLE_MEMORY overflowMemory = (mPartitionWorkers > 1) ? TABLE_MEMORY::SHARED : TABLE_MEMORY::HEAP;
+		mBOverflow.Allocate(mTotalPositions / OVERFLOW_POSITIONS_PER_SLOT, overflowMemory);
+		mZOverflow.Allocate(mTotalPositions / OVERFLOW_POSITIONS_PER_SLOT, overflowMemory);
 	}
+}
 
+string Checkmate::GetSignature()
+{
+	string filename = MakeFilenameFromPieces(mPieces);
+	return filename.substr(filename.find_last_of("\\/") + 1);
 }
 
-Checkmate::~Checkmate()
+// Gets one of the big arrays, or stops the program with a message saying which one didn't fit.
+// FILE_BACKED arrays get a scratch file in mOutOfCoreDirectory.
+void* Checkmate::AllocateArray(const char* name, long long bytes, TABLE_MEMORY kind)
 {
-	if (mLegalMovesRawMemory)
-		delete[] mLegalMovesRawMemory;
+	string backingFile;
+	if (kind == TABLE_MEMORY::FILE_BACKED)
+	{
+		backingFile = mOutOfCoreDirectory + "/" + GetSignature() + "." + name + ".scratch";
+	}
+
+	void* memory = AllocateTableMemory(bytes, kind, backingFile, mHugePages, mNumaPolicy);
+	if (memory == NULL)
+	{
+		cout << "Could not get " << bytes << " bytes for " << name << "." << endl;
+		if (kind == TABLE_MEMORY::FILE_BACKED)
+			cout << "Check that " << mOutOfCoreDirectory << " exists and has room." << endl;
+		else
+			cout << "Use out-of-core generation (SetOutOfCore) for tables bigger than memory." << endl;
+		Assert(false, "AllocateArray");
+	}
+	return memory;
+}
+
+// Says what page size each big array really got.
+void Checkmate::ReportPageSizes()
+{
+	cout << "\nPage sizes:" << endl;
+	ReportTableMemoryPages("B", B, mTotalPositions);
+	ReportTableMemoryPages("S", S, mTotalPositions);
+	ReportTableMemoryPages("Z", Z, mTotalPositions);
+	ReportTableMemoryPages("mLegalMovesRawMemory", mLegalMovesRawMemory, mLegalMovesRawMemoryRequested * sizeof(unsigned int));
+	ReportTableMemoryPages("mLegalMoves2", mLegalMoves2, (mTotalPositions + 1) * sizeof(long long));
+}
+
+long long Checkmate::GetTableMemoryBytes()
+{
+	long long bytes = 0;
 	if (B)
-		delete[] B;
+		bytes += mTotalPositions;
 	if (S)
-		delete[] S;
+		bytes += mTotalPositions;
+	if (Z)
+		bytes += mTotalPositions;
+	if (mLegalMovesRawMemory)
+		bytes += mLegalMovesRawMemoryRequested * sizeof(unsigned int);
 	if (mLegalMoves2)
-		delete[] mLegalMoves2;
+		bytes += (mTotalPositions + 1) * sizeof(long long);
+	bytes += mStatusPlanes.GetBytes();
+	return bytes;
+}
+
+// Gathers ILLEGAL_PLANE from S, or from B if there is no S, for IsLegalPosition.
+void Checkmate::UpdateStatusPlanes()
+{
+	mStatusPlanesReady = false;
+	if (!mUseStatusPlanes)
+		return;
+	if (!mStatusPlanes.IsAllocated())
+		mStatusPlanes.Allocate(mTotalPositions, STATUS_PLANE_COUNT);
+	if (S != NULL)
+		mStatusPlanes.GatherStatus(ILLEGAL_PLANE, S, ANY_ILLEGAL);
+	else
+		mStatusPlanes.GatherValue(ILLEGAL_PLANE, B, ILLEGAL);
+	mStatusPlanesReady = true;
+}
+
+Checkmate::~Checkmate()
+{
+	StopPartitionWorkers();
+	FreeTableMemory(mLegalMovesRawMemory);
+	FreeTableMemory(B);
+	FreeTableMemory(S);
+	FreeTableMemory(Z);
+	FreeTableMemory(mLegalMoves2);
 }
 
 void Checkmate::FromIndex(int index, vector<int>& positions)
 {
+	int turn = 0;
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+	{
+		turn = index % 2;
+		index = index / 2;
+	}
 //	vector<int> temp(mPieces.size() + 1);
 	for (size_t i = mPieces.size(); i > 0; i--)
 	{
@@ -278,12 +523,18 @@ void Checkmate::FromIndex(int index, vector<int>& positions)
 			index = index / KING_SQUARES;
 		}
 	}
-	positions[0] = index;
+	positions[0] = (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED) ? turn : index;
 //	positions = temp;
 }
 
 void Checkmate::FromIndex(int index, int positions[])
 {
+	int turn = 0;
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+	{
+		turn = index % 2;
+		index = index / 2;
+	}
 	//	vector<int> temp(mPieces.size() + 1);
 	for (size_t i = POSITION_ARRAY_SIZE-1; i > 0; i--)
 	{
@@ -298,10 +549,45 @@ void Checkmate::FromIndex(int index, int positions[])
 			index = index / KING_SQUARES;
 		}
 	}
-	positions[0] = index;
+	positions[0] = (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED) ? turn : index;
 	//	positions = temp;
 }
 
+int Checkmate::GetIndexScheme()
+{
+	return (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED) ? INDEX_SCHEME_INTERLEAVED : INDEX_SCHEME;
+}
+
+// TURN_MAJOR files have no footer, so they stay the same as ever.
+void Checkmate::WriteIndexFooter(std::ostream& out)
+{
+	if (mIndexLayout == INDEX_LAYOUT::TURN_MAJOR)
+		return;
+	long long footer[2] = { GetIndexScheme(), 1 };
+	out.write((const char*)footer, sizeof(footer));
+	out.write(INDEX_FOOTER_MAGIC, 8);
+}
+
+// From the combined table if there is one, since that is what loads, or else the table file.
+INDEX_LAYOUT Checkmate::ReadIndexLayout(const std::vector< PIECE_TYPES>& mPieces)
+{
+	string filename = MakeFilenameFromPieces(mPieces) + (CombinedTableExists(mPieces) ? ".combined.bin" : ".table.bin");
+	ifstream fin(filename, ios::binary);
+	fin.seekg(0, ios::end);
+	long long size = (long long)fin.tellg();
+	if (!fin || size < GetTotalPositions(mPieces) + INDEX_FOOTER_BYTES)
+		return INDEX_LAYOUT::TURN_MAJOR;
+	long long footer[2];
+	char magic[8];
+	fin.seekg(size - INDEX_FOOTER_BYTES);
+	fin.read((char*)footer, sizeof(footer));
+	fin.read(magic, 8);
+	if (!fin || memcmp(magic, INDEX_FOOTER_MAGIC, 8) != 0 || footer[1] != 1)
+		return INDEX_LAYOUT::TURN_MAJOR;
+	Assert(footer[0] == INDEX_SCHEME || footer[0] == INDEX_SCHEME_INTERLEAVED, "Unknown index scheme in the table's footer");
+	return (footer[0] == INDEX_SCHEME_INTERLEAVED) ? INDEX_LAYOUT::TURN_INTERLEAVED : INDEX_LAYOUT::TURN_MAJOR;
+}
+
 int Checkmate::ToIndex(const std::vector<int>& positions)
 {
 	//int index =	t*KING_SQUARES*KING_SQUARES*OTHER_SQUARES*OTHER_SQUARES + 
@@ -311,7 +597,7 @@ int Checkmate::ToIndex(const std::vector<int>& positions)
 	//			l;
 
 	//int index = OTHER_SQUARES * (OTHER_SQUARES * (KING_SQUARES * (t * KING_SQUARES + i) + j) + k) + l;
-	int index = positions[0]; // the turn t
+	int index = (mIndexLayout == INDEX_LAYOUT::TURN_MAJOR) ? positions[0] : 0; // the turn t
 	for (unsigned int i = 1; i < positions.size(); i++)
 	{
 		if (i <= 2)
@@ -320,12 +606,14 @@ int Checkmate::ToIndex(const std::vector<int>& positions)
 			index *= OTHER_SQUARES;
 		index += positions[i];
 	}
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+		index = index * 2 + positions[0];
 	return index;
 }
 
 int Checkmate::ToIndex(const int positions[])
 {
-	int index = positions[0]; // the turn t
+	int index = (mIndexLayout == INDEX_LAYOUT::TURN_MAJOR) ? positions[0] : 0; // the turn t
 	for (unsigned int i = 1; i < POSITION_ARRAY_SIZE; i++)
 	{
 		if (i <= 2)
@@ -334,6 +622,8 @@ int Checkmate::ToIndex(const int positions[])
 			index *= OTHER_SQUARES;
 		index += positions[i];
 	}
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+		index = index * 2 + positions[0];
 	return index;
 }
 
@@ -343,7 +633,10 @@ void Checkmate::InitBoardB()
 	CoutLongLongAsCommaInteger(mTotalPositions);
 	cout << "Initializing all board values to \"UNKNOWN\"..." << endl;
 	for (int p = 0; p < mTotalPositions; p++)
+	{
 		B[p] = UNKNOWN;
+		Z[p] = UNKNOWN;
+	}
 }
 
 void Checkmate::InitAllStatusBitsS()
@@ -458,6 +751,8 @@ void Checkmate::InitBadPawns()
 
 bool Checkmate::IsLegalPosition(int position)
 {
+	if (mStatusPlanesReady)
+		return !mStatusPlanes.Test(ILLEGAL_PLANE, position);
 	if (S != NULL)
 	{
 		char s = S[position];
@@ -847,6 +1142,8 @@ void Checkmate::CacheAllLegalMovesForAllPositions()
 	for (int p = 0; p < mTotalPositions; p++)
 	{
 		CacheAllLegalMovesForThisPosition(p);
+		if (mOutOfCoreBlockPositions && (p + 1) % mOutOfCoreBlockPositions == 0)
+			ReleaseMoveCacheRange((int)(p + 1 - mOutOfCoreBlockPositions), p + 1, mLegalMovesRawMemoryIndex);
 	}
 	mLegalMoves2[mTotalPositions] = mLegalMovesRawMemoryIndex++;
 	Assert(mLegalMovesRawMemoryIndex <= mLegalMovesRawMemoryRequested, "Error. Increase mLegalMovesRawMemoryRequested");
@@ -861,9 +1158,21 @@ void Checkmate::CacheAllLegalMovesForThisPosition(int p)
 	}
 	mLegalMoves2[p] = mLegalMovesRawMemoryIndex;
 
+	unsigned int successors[MAX_SUCCESSORS];
+	int count = GenerateSuccessors(p, successors);
+	if (mLegalMovesRawMemoryIndex + count > mLegalMovesRawMemoryRequested)
+		Assert(false, "mLegalMovesRawMemoryIndex >= mLegalMovesRawMemoryRequested");
+	for (int i = 0; i < count; i++)
+		mLegalMovesRawMemory[mLegalMovesRawMemoryIndex++] = successors[i];
+}
+
+// Finds the index of every position the player whose turn it is can move to from p.
+int Checkmate::GenerateSuccessors(int p, unsigned int successors[MAX_SUCCESSORS])
+{
 	if (!IsLegalPosition(p))
-		return; // There are no legal moves if we start from an illegal position.
+		return 0; // There are no legal moves if we start from an illegal position.
 
+	int count = 0;
 	int positions[POSITION_ARRAY_SIZE];
 	FromIndex(p, positions);
 	PIECE_COLOR turn = (PIECE_COLOR)positions[0];
@@ -885,15 +1194,48 @@ void Checkmate::CacheAllLegalMovesForThisPosition(int p)
 			allLegalMoves, legalMoveCount);
 
 		for (int i = 0; i < legalMoveCount; i++)
-		{
-			int newIndex = ToReplaceIndex(positions,
+			successors[count++] = ToReplaceIndex(positions,
 				pieceIndex, allLegalMoves[i].newPosition);
+	}
+	return count;
+}
 
-			if (mLegalMovesRawMemoryIndex >= mLegalMovesRawMemoryRequested)
-				Assert(false, "mLegalMovesRawMemoryIndex >= mLegalMovesRawMemoryRequested");
-			else
-				mLegalMovesRawMemory[mLegalMovesRawMemoryIndex++] = newIndex;
-		}
+const unsigned int* Checkmate::GetSuccessors(int p, unsigned int buffer[MAX_SUCCESSORS], int& count)
+{
+	if (mOnTheFlySuccessors)
+	{
+		count = GenerateSuccessors(p, buffer);
+		mSuccessorsVisited += count;
+		return buffer;
+	}
+	count = (int)(mLegalMoves2[p + 1] - mLegalMoves2[p]);
+	mSuccessorsVisited += count;
+	return mLegalMovesRawMemory + mLegalMoves2[p];
+}
+
+static inline void PrefetchByte(const void* address)
+{
+#ifdef CHECKMATE_SSE
+	_mm_prefetch((const char*)address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(address);
+#endif
+}
+
+void Checkmate::PrefetchSuccessors(int p, bool zeroing)
+{
+	if (!mSolverPrefetch || mOnTheFlySuccessors)
+		return;
+	if ((zeroing ? Z[p] : B[p]) != UNKNOWN)
+		return;
+	const unsigned int* successors = mLegalMovesRawMemory + mLegalMoves2[p];
+	int count = (int)(mLegalMoves2[p + 1] - mLegalMoves2[p]);
+	for (int m = 0; m < count; m++)
+	{
+		PrefetchByte(B + successors[m]);
+		PrefetchByte(S + successors[m]);
+		if (zeroing)
+			PrefetchByte(Z + successors[m]);
 	}
 }
 
@@ -1509,31 +1851,54 @@ void Checkmate::AssignPawnPromotions(PIECE_TYPES fromPawn, PIECE_TYPES toQueen,
 		return;
 
 	bool needTableS = true;
-	char* BPromotedPawns = NULL;
-	unsigned char* SPromotedPawns = NULL;
-
-	try
-	{
-		std::cout << "Trying to get " << mTotalPositions << " bytes for SPromotedPawns..." << endl;
-		SPromotedPawns = new unsigned char[mTotalPositions];
-		std::cout << "Got the memory!" << endl;
-
-		std::cout << "Trying to get " << mTotalPositions << " bytes for BPromotedPawns..." << endl;
-		BPromotedPawns = new char[mTotalPositions];
-		std::cout << "Got the memory!" << endl;
+	std::cout << "Trying to get " << mTotalPositions << " bytes for SPromotedPawns..." << endl;
+	unsigned char* SPromotedPawns = (unsigned char*)AllocateArray("SPromotedPawns", mTotalPositions, mTableMemory);
+	std::cout << "Got the memory!" << endl;
+
+	std::cout << "Trying to get " << mTotalPositions << " bytes for BPromotedPawns..." << endl;
+	char* BPromotedPawns = (char*)AllocateArray("BPromotedPawns", mTotalPositions, mTableMemory);
+	std::cout << "Got the memory!" << endl;
+
+	Assert(ReadIndexLayout(mPiecesPromotedPawn) == mIndexLayout,
+		"The pawn promoted table has another index layout. Make it again with this one.");
+	// The combined table has all of B and S that the passes after this read. The status file has
+	// more, like IN_CHECK, that this table's status file copies, so it is read when that is saved too.
+	bool loaded;
+	bool legacyFiles = mLegacyTableFiles && ifstream(MakeFilenameFromPieces(mPiecesPromotedPawn) + ".status.bin");
+	if (CombinedTableExists(mPiecesPromotedPawn) && !legacyFiles)
+	{
+		loaded = LoadCombinedTable(mPiecesPromotedPawn, BPromotedPawns);
+		if (loaded)
+			SplitCombinedTable(BPromotedPawns, SPromotedPawns);
+		// That read the promoted table's statistics. This table's are counted at the end.
+		mHaveStats = false;
 	}
-	catch (int e)
+	else
+		loaded = LoadTable1(needTableS, mPiecesPromotedPawn, BPromotedPawns, SPromotedPawns);
+	if (!loaded)
 	{
-		std::cout << "An exception occurred getting SPromotedPawns or BPromotedPawns. " << e << '\n';
+		cout << "Error loading pawn promoted data files!" << endl;
 		system("pause");
 		exit(1);
 	}
-	if (!LoadTable1(needTableS, mPiecesPromotedPawn, BPromotedPawns, SPromotedPawns))
+
+	// Without it, the promotion positions get their Z from this table's passes instead.
+	// They can only be reached by a pawn move, so that changes no other position's Z.
+	char* ZPromotedPawns = NULL;
+	if (DtzTableExists(mPiecesPromotedPawn))
 	{
-		cout << "Error loading pawn promoted data files!" << endl;
-		system("pause");
-		exit(1);
+		ZPromotedPawns = (char*)AllocateArray("ZPromotedPawns", mTotalPositions, mTableMemory);
+		if (!LoadDtzTable(mPiecesPromotedPawn, ZPromotedPawns))
+		{
+			FreeTableMemory(ZPromotedPawns);
+			ZPromotedPawns = NULL;
+		}
 	}
+	else
+		cout << "The pawn promoted table has no DTZ data." << endl;
+	OverflowStore bOverflowPromotedPawns;
+	OverflowStore zOverflowPromotedPawns;
+	LoadOverflows(mPiecesPromotedPawn, bOverflowPromotedPawns, zOverflowPromotedPawns);
 
 	for (int p = 0; p < mTotalPositions; p++)
 	{
@@ -1555,18 +1920,30 @@ void Checkmate::AssignPawnPromotions(PIECE_TYPES fromPawn, PIECE_TYPES toQueen,
 					{
 						B[p] = BPromotedPawns[p];
 						S[p] = SPromotedPawns[p];
+						if (IsOverflow(B[p]))
+							SetMovesToCheckmateCount(p, bOverflowPromotedPawns.Get(p));
+						if (ZPromotedPawns)
+						{
+							Z[p] = ZPromotedPawns[p];
+							if (IsOverflow(Z[p]))
+								SetMovesToZeroingCount(p, zOverflowPromotedPawns.Get(p));
+						}
 					}
 				}
 			}
 		}
 	}
-	delete[]BPromotedPawns;
-	delete[]SPromotedPawns;
+	FreeTableMemory(BPromotedPawns);
+	FreeTableMemory(SPromotedPawns);
+	if (ZPromotedPawns)
+		FreeTableMemory(ZPromotedPawns);
 }
 
 int Checkmate::GetLegalMovesCount(int currentPosition)
 {
-	int count = (int)(mLegalMoves2[currentPosition + 1] - mLegalMoves2[currentPosition]);
+	unsigned int buffer[MAX_SUCCESSORS];
+	int count;
+	GetSuccessors(currentPosition, buffer, count);
 	return count;
 }
 
@@ -1574,11 +1951,24 @@ int Checkmate::GetLegalMovesCount(int currentPosition)
 // Check for white or black to mate in x
 int Checkmate::IsMateInX(int x)
 {
-	int count = 0;
 	//	cout << "Finding all board positions that are Mate In " << x << "... ";
 	cout << x << ": ";
-	for (int p = 0; p < mTotalPositions; p++)
+	int whiteCount = 0;
+	int blackCount = 0;
+	RunSolverPass(SOLVER_PASS::MATE_IN_X, x, whiteCount, blackCount);
+	int count = whiteCount + blackCount;
+	cout << count << " ";
+	return count;
+}
+
+// The positions from begin up to end, for IsMateInX.
+void Checkmate::IsMateInXRange(int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	int stride = GetSolverStride();
+	for (int p = begin; p < end; p += stride)
 	{
+		if (p + SOLVER_PREFETCH_DISTANCE * stride < end)
+			PrefetchSuccessors(p + SOLVER_PREFETCH_DISTANCE * stride, false);
 		int positions[POSITION_ARRAY_SIZE];
 		FromIndex(p, positions);
 		if (p == 8519)
@@ -1594,15 +1984,18 @@ int Checkmate::IsMateInX(int x)
 
 			bool mateInX = false; // unless shown otherwise
 			PIECE_COLOR t = (PIECE_COLOR)positions[0];
-			int legalMoveCount = (int) (mLegalMoves2[p + 1] - mLegalMoves2[p]);
-			long long rawIndex = mLegalMoves2[p];
+			unsigned int buffer[MAX_SUCCESSORS];
+			int legalMoveCount;
+			const unsigned int* successors = GetSuccessors(p, buffer, legalMoveCount);
 			for (int m = 0; m < legalMoveCount; m++)
 			{
-				int newIndex = mLegalMovesRawMemory[rawIndex + m];
+				int newIndex = successors[m];
 				int pos2[POSITION_ARRAY_SIZE];
 				FromIndex(newIndex, pos2);
-				char x2 = B[newIndex];
+				int x2 = B[newIndex];
 				char s2 = S[newIndex];
+				if (x > POSITIVE_OVERFLOW && IsOverflow(x2))
+					x2 = mBOverflow.Get(newIndex); // can only be x - 1 past the char range
 
 				if (x == 1)
 				{
@@ -1625,15 +2018,15 @@ int Checkmate::IsMateInX(int x)
 			}
 			if (mateInX)
 			{
-				count++;
+				if (t == PIECE_COLOR::WHITE)
+					whiteCount++;
+				else
+					blackCount++;
 //				cout << p << " ";
-				B[p] = (t == PIECE_COLOR::WHITE) ? x : -x;
+				SetMovesToCheckmateCount(p, (t == PIECE_COLOR::WHITE) ? x : -x);
 			}
 		}
 	}
-//		cout << count << endl;
-	cout << count << " ";
-	return count;
 }
 
 
@@ -1643,9 +2036,21 @@ int Checkmate::IsResponseMateInX(int x)
 	int blackCount = 0;
 	int whiteCount = 0;
 	//	cout << "Finding loser positions that can be mated in " << x << "... ";
+	RunSolverPass(SOLVER_PASS::RESPONSE_MATE_IN_X, x, whiteCount, blackCount);
+	//	cout << " (" << whiteCount << ") and (" << blackCount << ")" << endl;
+	cout << " (" << whiteCount << ") and (" << blackCount << ") ";
+	return whiteCount + blackCount;
+}
+
+// The positions from begin up to end, for IsResponseMateInX.
+void Checkmate::IsResponseMateInXRange(int x, int begin, int end, int& whiteCount, int& blackCount)
+{
 	//int signedX = -x;
-	for (int p = 0; p < mTotalPositions; p++)
+	int stride = GetSolverStride();
+	for (int p = begin; p < end; p += stride)
 	{
+		if (p + SOLVER_PREFETCH_DISTANCE * stride < end)
+			PrefetchSuccessors(p + SOLVER_PREFETCH_DISTANCE * stride, false);
 		int positions[POSITION_ARRAY_SIZE];
 		FromIndex(p, positions);
 
@@ -1658,7 +2063,7 @@ int Checkmate::IsResponseMateInX(int x)
 			bool responseMateInX = true; // unless shown otherwise
 			int legalMoveCount = 0;
 			char s2A[500];
-			char x2A[500];
+			int x2A[500];
 			bool breakOnUnknownExists = true;
 			bool unknownExists = GetLegalMovesMetrics(currentIndex, s2A, x2A, legalMoveCount, breakOnUnknownExists);
 			if (unknownExists)
@@ -1667,9 +2072,9 @@ int Checkmate::IsResponseMateInX(int x)
 			for (int m = 0; m < legalMoveCount; m++)
 			{
 				char s2 = s2A[m];
-				char x2 = x2A[m];
+				int x2 = x2A[m];
 
-				if ((s2 & IN_STALE_MATE) || (s2 & INSUFFICIENT_MATERIAL) || x2 == UNKNOWN || abs(x2) > x /* cannot response mate in x moves or less */ || signedX * x2 < 0 /* a switch of who can win */)
+				if ((s2 & IN_STALE_MATE) || (s2 & INSUFFICIENT_MATERIAL) || abs(x2) > x /* cannot response mate in x moves or less */ || signedX * x2 < 0 /* a switch of who can win */)
 				{
 					responseMateInX = false;
 					break;
@@ -1681,19 +2086,16 @@ int Checkmate::IsResponseMateInX(int x)
 				if (t == PIECE_COLOR::WHITE)
 				{
 					blackCount += 1;
-					B[currentIndex] = signedX;
+					SetMovesToCheckmateCount(currentIndex, signedX);
 				}
 				else
 				{
 					whiteCount += 1;
-					B[currentIndex] = signedX;
+					SetMovesToCheckmateCount(currentIndex, signedX);
 				}
 			}
 		} // if IsLegalPosition(p)
 	} // for p
-	//	cout << " (" << whiteCount << ") and (" << blackCount << ")" << endl;
-	cout << " (" << whiteCount << ") and (" << blackCount << ") ";
-	return whiteCount + blackCount;
 }
 
 
@@ -1710,6 +2112,54 @@ char Checkmate::GetMovesToCheckmateCount(int p)
 	return B[p];
 }
 
+int Checkmate::GetFullMovesToCheckmateCount(const int positions[])
+{
+	return GetFullMovesToCheckmateCount(ToIndex(positions));
+}
+
+int Checkmate::GetFullMovesToCheckmateCount(int p)
+{
+	char count = B[p];
+	if (IsOverflow(count))
+	{
+		int fullCount = mBOverflow.Get(p);
+		if (fullCount != 0)
+			return fullCount;
+	}
+	return count;
+}
+
+// Keeps the sign in table, so the count is still right for who is winning.
+void Checkmate::SetOverflowCount(char* table, OverflowStore& overflow, int p, int count)
+{
+	table[p] = (count > 0) ? POSITIVE_OVERFLOW : NEGATIVE_OVERFLOW;
+	overflow.Set(p, count);
+}
+
+char Checkmate::GetMovesToZeroingCount(const int positions[])
+{
+	return GetMovesToZeroingCount(ToIndex(positions));
+}
+
+char Checkmate::GetMovesToZeroingCount(int p)
+{
+	if (Z == NULL)
+		return UNKNOWN; // the table was made before there were DTZ files
+	return Z[p];
+}
+
+int Checkmate::GetFullMovesToZeroingCount(int p)
+{
+	char count = GetMovesToZeroingCount(p);
+	if (IsOverflow(count))
+	{
+		int fullCount = mZOverflow.Get(p);
+		if (fullCount != 0)
+			return fullCount;
+	}
+	return count;
+}
+
 
 unsigned char Checkmate::GetStatus(const int positions[])
 {
@@ -1721,21 +2171,24 @@ unsigned char Checkmate::GetStatus(const int positions[])
 unsigned char Checkmate::GetStatus(int p)
 {
 	//	SymmetryConversion(blackKing, whiteKing, other1, other2);
+	if (S == NULL)
+		return StatusFromCombinedValue(B[p]); // only B was loaded
 	return S[p];
 }
 
 
 // 
 bool Checkmate::GetLegalMovesMetrics(int currentPosition,
-	char s2[], char x2[], int& moveCount, bool breakOnUnknownExists)
+	char s2[], int x2[], int& moveCount, bool breakOnUnknownExists)
 {
 	moveCount = 0;
-	int totalLegalMoves = GetLegalMovesCount(currentPosition);
-	long long rawIndex = mLegalMoves2[currentPosition];
+	unsigned int buffer[MAX_SUCCESSORS];
+	int totalLegalMoves;
+	const unsigned int* successors = GetSuccessors(currentPosition, buffer, totalLegalMoves);
 	for (int m = 0; m < totalLegalMoves; m++)
 	{
-		int newIndex = mLegalMovesRawMemory[rawIndex + m];
-		int toMateCount = B[newIndex];
+		int newIndex = successors[m];
+		char toMateCount = B[newIndex];
 		if (toMateCount == UNKNOWN || toMateCount == UNFORCEABLE)
 		{
 			if (breakOnUnknownExists)
@@ -1743,7 +2196,7 @@ bool Checkmate::GetLegalMovesMetrics(int currentPosition,
 		}
 		else // only store moves where the toMateCount is known.
 		{
-			x2[moveCount] = toMateCount;
+			x2[moveCount] = GetFullMovesToCheckmateCount(newIndex); // the real count, past POSITIVE_OVERFLOW too
 			s2[moveCount] = S[newIndex];
 			moveCount++;
 		}
@@ -1758,8 +2211,19 @@ int Checkmate::CanInsufficientMaterialInX(int x)
 	int blackCount = 0;
 	int whiteCount = 0;
 	cout << "Finding INSUFFICIENT_MATERIAL In " << x << "...";
-	for (int p = 0; p < mTotalPositions; p++)
+	RunSolverPass(SOLVER_PASS::INSUFFICIENT_IN_X, x, whiteCount, blackCount);
+	cout << " (" << whiteCount << ") and (" << blackCount << ")" << endl;
+	return whiteCount + blackCount;
+}
+
+// The positions from begin up to end, for CanInsufficientMaterialInX.
+void Checkmate::CanInsufficientMaterialInXRange(int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	int stride = GetSolverStride();
+	for (int p = begin; p < end; p += stride)
 	{
+		if (p + SOLVER_PREFETCH_DISTANCE * stride < end)
+			PrefetchSuccessors(p + SOLVER_PREFETCH_DISTANCE * stride, false);
 		int positions[POSITION_ARRAY_SIZE];
 		FromIndex(p, positions);
 		PIECE_COLOR t = (PIECE_COLOR)positions[0];
@@ -1769,13 +2233,16 @@ int Checkmate::CanInsufficientMaterialInX(int x)
 			int currentIndex = p;
 			bool drawInX = false; // unless shown otherwise
 
-			int legalMoveCount2 = (int)(mLegalMoves2[currentIndex + 1] - mLegalMoves2[currentIndex]);
-			long long rawIndex = mLegalMoves2[currentIndex];
+			unsigned int buffer[MAX_SUCCESSORS];
+			int legalMoveCount2;
+			const unsigned int* successors = GetSuccessors(currentIndex, buffer, legalMoveCount2);
 			for (int m = 0; m < legalMoveCount2; m++)
 			{
-				int newIndex = mLegalMovesRawMemory[rawIndex + m];
-				char x2 = B[newIndex];
+				int newIndex = successors[m];
+				int x2 = B[newIndex];
 				char s2 = S[newIndex];
+				if (x > POSITIVE_OVERFLOW && IsOverflow(x2))
+					x2 = mBOverflow.Get(newIndex);
 
 				if (x == 1)
 				{
@@ -1803,18 +2270,16 @@ int Checkmate::CanInsufficientMaterialInX(int x)
 				if (t == PIECE_COLOR::WHITE)
 				{
 					whiteCount += 1;
-					B[currentIndex] = x;
+					SetMovesToCheckmateCount(currentIndex, x);
 				}
 				else
 				{
 					blackCount += 1;
-					B[currentIndex] = -x;
+					SetMovesToCheckmateCount(currentIndex, -x);
 				}
 			}
 		} // if IsLegalPosition(p)
 	} // for p
-	cout << " (" << whiteCount << ") and (" << blackCount << ")" << endl;
-	return whiteCount + blackCount;
 }
 
 
@@ -1824,8 +2289,19 @@ int Checkmate::CanResponseInsufficientMaterialInX(int x)
 	int blackCount = 0;
 	int whiteCount = 0;
 	cout << "Unlucky INSUFFICIENT_MATERIAL response in " << x << "... ";
-	for (int p = 0; p < mTotalPositions; p++)
+	RunSolverPass(SOLVER_PASS::RESPONSE_INSUFFICIENT_IN_X, x, whiteCount, blackCount);
+	cout << " (" << whiteCount << ") and (" << blackCount << ")" << endl;
+	return whiteCount + blackCount;
+}
+
+// The positions from begin up to end, for CanResponseInsufficientMaterialInX.
+void Checkmate::CanResponseInsufficientMaterialInXRange(int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	int stride = GetSolverStride();
+	for (int p = begin; p < end; p += stride)
 	{
+		if (p + SOLVER_PREFETCH_DISTANCE * stride < end)
+			PrefetchSuccessors(p + SOLVER_PREFETCH_DISTANCE * stride, false);
 		int positions[POSITION_ARRAY_SIZE];
 		FromIndex(p, positions);
 		PIECE_COLOR t = (PIECE_COLOR)positions[0];
@@ -1837,7 +2313,7 @@ int Checkmate::CanResponseInsufficientMaterialInX(int x)
 			bool responseInsufficientInX = true; // unless shown otherwise
 			int legalMoveCount = 0;
 			char s2A[500];
-			char x2A[500];
+			int x2A[500];
 			bool breakOnUnknownExists = true;
 			bool unknownExists = GetLegalMovesMetrics(currentIndex, s2A, x2A, legalMoveCount, breakOnUnknownExists);
 			if (unknownExists)
@@ -1846,9 +2322,9 @@ int Checkmate::CanResponseInsufficientMaterialInX(int x)
 			for (int m = 0; m < legalMoveCount; m++)
 			{
 				char s2 = s2A[m];
-				char x2 = x2A[m];
+				int x2 = x2A[m];
 
-				if (x2 == UNKNOWN || abs(x2) > x || !(s2 & IN_STALE_MATE || s2 & INSUFFICIENT_MATERIAL)  /* cannot response insufficient in x moves or less */ || signedX * x2 < 0 /* a switch of who can draw */)
+				if (abs(x2) > x || !(s2 & IN_STALE_MATE || s2 & INSUFFICIENT_MATERIAL)  /* cannot response insufficient in x moves or less */ || signedX * x2 < 0 /* a switch of who can draw */)
 				{
 					responseInsufficientInX = false;
 					break;
@@ -1861,177 +2337,349 @@ int Checkmate::CanResponseInsufficientMaterialInX(int x)
 				if (t == PIECE_COLOR::WHITE)
 				{
 					blackCount += 1;
-					B[currentIndex] = signedX;
+					SetMovesToCheckmateCount(currentIndex, signedX);
 				}
 				else
 				{
 					whiteCount += 1;
-					B[currentIndex] = signedX;
+					SetMovesToCheckmateCount(currentIndex, signedX);
 				}
 			}
 		}
 	}
-	cout << " (" << whiteCount << ") and (" << blackCount << ")" << endl;
-	return whiteCount + blackCount;
 }
 
-
-void Checkmate::PrintEvaluation()
+// Check for the winner to make a capture, pawn move or checkmate in x, keeping the win
+int Checkmate::IsZeroingInX(int x)
 {
-	int totalCount = 0;
-	int illegalCount = 0;
-
-	int whiteCheckmateCount = 0;
-	int blackCheckmateCount = 0;
-	int whiteKnownMateCount = 0;
-	int blackKnownMateCount = 0;
-
-	int insufficientMaterialCount = 0;
-	int insufficientIn1Count = 0;
-	int insufficientIn2Count = 0;
-	int insufficientIn3Count = 0;
-
-	int stalemateCount = 0;
-	int stalemateIn1Count = 0;
-	int stalemateIn2Count = 0;
-	int stalemateIn3Count = 0;
-
-	int unknownMate = 0;
-	int unForceable = 0;
-
-	int mateInX[100] = { 0 };
-	int responseMateInX[100] = { 0 };
-	int highestX = 1;
-
+	cout << x << ": ";
+	int whiteCount = 0;
+	int blackCount = 0;
+	RunSolverPass(SOLVER_PASS::ZEROING_IN_X, x, whiteCount, blackCount);
+	int count = whiteCount + blackCount;
+	cout << count << " ";
+	return count;
+}
 
-	cout << "\nGathering statistics on all data positions..." << endl;
-	for (int p = 0; p < mTotalPositions; p++)
+// The positions from begin up to end, for IsZeroingInX.
+void Checkmate::IsZeroingInXRange(int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	int stride = GetSolverStride();
+	for (int p = begin; p < end; p += stride)
 	{
+		if (p + SOLVER_PREFETCH_DISTANCE * stride < end)
+			PrefetchSuccessors(p + SOLVER_PREFETCH_DISTANCE * stride, true);
+		if (Z[p] != UNKNOWN || !IsLegalPosition(p))
+			continue;
+		PIECE_COLOR t = GetTurnFromPosition(p);
+		if (GetExpectedWinner(p) != t)
+			continue; // only the winner's positions
+
 		int positions[POSITION_ARRAY_SIZE];
 		FromIndex(p, positions);
-		PIECE_COLOR t = (PIECE_COLOR)positions[0];
-		totalCount += 1;
-
-		int mateCount = GetMovesToCheckmateCount(p);
-		char S = GetStatus(p);
-
-		if (!IsLegalPosition(p))
-			illegalCount += 1;
-		else if (S & INSUFFICIENT_MATERIAL && mateCount == 0)
-			insufficientMaterialCount++;
-		else if (S & INSUFFICIENT_MATERIAL && abs(mateCount) == 1)
-			insufficientIn1Count++;
-		else if (S & INSUFFICIENT_MATERIAL && abs(mateCount) == 2)
-			insufficientIn2Count++;
-		else if (S & INSUFFICIENT_MATERIAL && abs(mateCount) >= 3)
-			insufficientIn3Count++;
-		else if (S & IN_STALE_MATE && mateCount == 0)
-			stalemateCount++;
-		else if (S & IN_STALE_MATE && abs(mateCount) == 1)
-			stalemateIn1Count++;
-		else if (S & IN_STALE_MATE && abs(mateCount) == 2)
-			stalemateIn2Count++;
-		else if (S & IN_STALE_MATE && abs(mateCount) >= 3)
-			stalemateIn3Count++;
-
-		else if (mateCount == UNKNOWN) /* mateCount is not known */
+		bool zeroingInX = false; // unless shown otherwise
+		unsigned int buffer[MAX_SUCCESSORS];
+		int legalMoveCount;
+		const unsigned int* successors = GetSuccessors(p, buffer, legalMoveCount);
+		for (int m = 0; m < legalMoveCount; m++)
 		{
-			unknownMate += 1;
-		} /* mateCount is not known */
-		else if (mateCount == UNFORCEABLE) /* mateCount is not forceable */
+			int newIndex = successors[m];
+			int z2 = Z[newIndex];
+			if (x > POSITIVE_OVERFLOW && IsOverflow(z2))
+				z2 = mZOverflow.Get(newIndex);
+			if (!(z2 != UNKNOWN && abs(z2) == x - 1) && !(x == 1 && IsZeroingMove(positions, newIndex)))
+				continue;
+			if (GetExpectedWinner(newIndex) == t) // doesn't give away the win
+			{
+				zeroingInX = true;
+				break;
+			}
+		}
+		if (zeroingInX)
 		{
-			unForceable += 1;
+			if (t == PIECE_COLOR::WHITE)
+				whiteCount++;
+			else
+				blackCount++;
+			SetMovesToZeroingCount(p, (t == PIECE_COLOR::WHITE) ? x : -x);
 		}
+	}
+}
 
-		else /* mateCount is known */
-		{
-			if (abs(mateCount) > highestX)
-				highestX = abs(mateCount);
+// Check for the loser to be unable to put off the winner's capture, pawn move or checkmate
+// for more than x. Zero finds checkmates and positions where the loser has to zero.
+int Checkmate::IsResponseZeroingInX(int x)
+{
+	int blackCount = 0;
+	int whiteCount = 0;
+	RunSolverPass(SOLVER_PASS::RESPONSE_ZEROING_IN_X, x, whiteCount, blackCount);
+	cout << " (" << whiteCount << ") and (" << blackCount << ") ";
+	return whiteCount + blackCount;
+}
 
-			if (mateCount > 0)
-			{
-				whiteKnownMateCount += 1;
-				if (t == PIECE_COLOR::WHITE)
-					mateInX[mateCount]++;
-				else
-					responseMateInX[mateCount]++;
-			}
-			else if (mateCount < 0)
-			{
-				blackKnownMateCount += 1;
-				if (t == PIECE_COLOR::WHITE)
-					mateInX[-mateCount]++;
-				else
-					responseMateInX[-mateCount]++;
-			}
-			else /* mateCount is zero */
+// The positions from begin up to end, for IsResponseZeroingInX.
+void Checkmate::IsResponseZeroingInXRange(int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	int stride = GetSolverStride();
+	for (int p = begin; p < end; p += stride)
+	{
+		if (p + SOLVER_PREFETCH_DISTANCE * stride < end)
+			PrefetchSuccessors(p + SOLVER_PREFETCH_DISTANCE * stride, true);
+		if (Z[p] != UNKNOWN || !IsLegalPosition(p))
+			continue;
+		PIECE_COLOR t = GetTurnFromPosition(p);
+		PIECE_COLOR winner = GetExpectedWinner(p);
+		if (winner != OtherColor(t))
+			continue; // only the loser's positions
+
+		int positions[POSITION_ARRAY_SIZE];
+		FromIndex(p, positions);
+		bool responseZeroingInX = true; // unless shown otherwise
+		unsigned int buffer[MAX_SUCCESSORS];
+		int legalMoveCount;
+		const unsigned int* successors = GetSuccessors(p, buffer, legalMoveCount);
+		for (int m = 0; m < legalMoveCount; m++)
+		{
+			int newIndex = successors[m];
+			char z2 = Z[newIndex];
+			if (z2 != UNKNOWN && z2 != UNFORCEABLE && abs(GetFullMovesToZeroingCount(newIndex)) <= x)
+				continue;
+			if (!IsZeroingMove(positions, newIndex)) // a zeroing move starts the count again
 			{
-				if (t == PIECE_COLOR::WHITE)
-					whiteCheckmateCount++;
-				else
-					blackCheckmateCount++;
+				responseZeroingInX = false;
+				break;
 			}
-		} /* mateCount is NOT known - not forceable */
-	} // for all board positions
+		}
+		if (responseZeroingInX)
+		{
+			if (winner == PIECE_COLOR::WHITE)
+				whiteCount++;
+			else
+				blackCount++;
+			SetMovesToZeroingCount(p, (winner == PIECE_COLOR::WHITE) ? x : -x);
+		}
+	}
+}
 
-	int stringWidth = 30;
-	int countWidth = 10;
-	cout << endl;
-	cout << setw(stringWidth) << "totalCount = " << setw(countWidth) << totalCount << endl;
-	cout << setw(stringWidth) << "illegalCount = " << setw(countWidth) << illegalCount << endl;
-
-	cout << setw(stringWidth) << "whiteCheckmateCount = " << setw(countWidth) << whiteCheckmateCount << endl;
-	cout << setw(stringWidth) << "blackCheckmateCount = " << setw(countWidth) << blackCheckmateCount << endl;
-	cout << setw(stringWidth) << "whiteKnownMateCount = " << setw(countWidth) << whiteKnownMateCount << endl;
-	cout << setw(stringWidth) << "blackKnownMateCount = " << setw(countWidth) << blackKnownMateCount << endl;
-	
-		for(int c=1; c<=highestX; c++)
+// Did the move from positions to newIndex capture a piece or move a pawn?
+bool Checkmate::IsZeroingMove(const int positions[], int newIndex)
+{
+	int positions2[POSITION_ARRAY_SIZE];
+	FromIndex(newIndex, positions2);
+	for (int pi = 2; pi < NUM_PIECES; pi++)
+	{
+		if (positions[pi + 1] != DEAD_POSITION && positions2[pi + 1] == DEAD_POSITION)
+			return true;
+		if ((mPieces[pi] == PIECE_TYPES::WHITE_PAWN || mPieces[pi] == PIECE_TYPES::BLACK_PAWN) &&
+			positions[pi + 1] != positions2[pi + 1])
+			return true;
+	}
+	return false;
+}
+
+// Says how many won positions would be drawn by the fifty move rule with best play.
+void Checkmate::ReportFiftyMoveRule()
+{
+	long long wins = 0;
+	long long tooLong = 0;
+	int longest = 0;
+	for (int p = 0; p < mTotalPositions; p++)
+	{
+		if (Z[p] == UNKNOWN || Z[p] == ILLEGAL || Z[p] == UNFORCEABLE || !IsLegalPosition(p))
+			continue;
+		wins++;
+		int count = abs(GetFullMovesToZeroingCount(p));
+		if (count > FIFTY_MOVE_RULE)
+			tooLong++;
+		longest = max(longest, count);
+	}
+	cout << "\nPositions one side can win: ";
+	CoutLongLongAsCommaInteger(wins);
+	cout << "Longest moves to a capture, pawn move or checkmate: " << longest << endl;
+	cout << "Won positions that need more than " << FIFTY_MOVE_RULE << " moves: ";
+	CoutLongLongAsCommaInteger(tooLong);
+}
+
+// Runs one solver pass over every position, either here or split among the partition workers.
+void Checkmate::RunSolverPass(SOLVER_PASS pass, int x, int& whiteCount, int& blackCount)
+{
+	whiteCount = 0;
+	blackCount = 0;
+	long long successorsBefore = mSuccessorsVisited;
+	mReport.BeginPhase(gSolverPassNames[(int)pass], x);
+	if (!mPartitionWorkerIds.empty())
+		RunPartitionedSolverPass(pass, x, whiteCount, blackCount);
+	else if (mSolverOrder == SOLVER_ORDER::KING_TILED && mOutOfCoreBlockPositions == 0)
+	{
+		for (mSolverTurn = 0; mSolverTurn < 2; mSolverTurn++)
 		{
-			char intAsString[100];
-			sprintf_s(intAsString,100,"%i",c);
-			cout << setw(stringWidth-strlen(intAsString)-3)<<"Mate in " << intAsString << " = " << setw(countWidth) << mateInX[c] << endl;
+			vector<int> kingPairs;
+			GetTiledKingPairs(mSolverTurn, 0, KING_SQUARES, kingPairs);
+			RunSolverPassTiled(pass, x, mSolverTurn, kingPairs, whiteCount, blackCount, true);
 		}
-		for(int c=1; c<=highestX; c++)
+	}
+	else
+	{
+		// In pieces, to show progress. Out-of-core, whole blocks at a time.
+		long long piece = (mTotalPositions + SOLVER_PROGRESS_STEPS - 1) / SOLVER_PROGRESS_STEPS;
+		if (mOutOfCoreBlockPositions)
+			piece = (piece + mOutOfCoreBlockPositions - 1) / mOutOfCoreBlockPositions * mOutOfCoreBlockPositions;
+		// White's turn, then Black's, the way TURN_MAJOR goes through them in index order.
+		// TURN_INTERLEAVED, that is two times through the table, each turn every other index.
+		int sweeps = (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED) ? 2 : 1;
+		for (mSolverTurn = 0; mSolverTurn < sweeps; mSolverTurn++)
 		{
-			char intAsString[100];
-			sprintf_s(intAsString,100,"%i",c);
-			cout << setw(stringWidth-strlen(intAsString)-3)<<"Response Mate in " << intAsString << " = " << setw(countWidth) << responseMateInX[c] << endl;
+			for (long long begin = 0; begin < mTotalPositions; begin += piece)
+			{
+				int end = (int)((begin + piece < mTotalPositions) ? begin + piece : mTotalPositions);
+				RunSolverPassBlocks(pass, x, (int)begin, end, whiteCount, blackCount);
+				mReport.UpdateProgress((mSolverTurn + (double)end / mTotalPositions) / sweeps);
+			}
 		}
-	
-	cout << setw(stringWidth) << "insufficientMaterialCount = " << setw(countWidth) << insufficientMaterialCount << endl;
-	cout << setw(stringWidth) << "insufficientIn1Count = " << setw(countWidth) << insufficientIn1Count << endl;
-	cout << setw(stringWidth) << "insufficientIn2Count = " << setw(countWidth) << insufficientIn2Count << endl;
-	cout << setw(stringWidth) << "insufficientIn3Count = " << setw(countWidth) << insufficientIn3Count << endl;
-	cout << endl;
-	cout << setw(stringWidth) << "stalemateCount = " << setw(countWidth) << stalemateCount << endl;
-	cout << setw(stringWidth) << "stalemateIn1Count = " << setw(countWidth) << stalemateIn1Count << endl;
-	cout << setw(stringWidth) << "stalemateIn2Count = " << setw(countWidth) << stalemateIn2Count << endl;
-	cout << setw(stringWidth) << "stalemateIn3Count = " << setw(countWidth) << stalemateIn3Count << endl;
-	cout << endl;
-	cout << setw(stringWidth) << "unknownMate = " << setw(countWidth) << unknownMate << endl;
-	cout << setw(stringWidth) << "Unforceable = " << setw(countWidth) << unForceable << endl;
-	cout << endl << "totalCount - illegalCount - whiteCheckmateCount - blackCheckmateCount" << endl;
-	cout << "- whiteKnownMateCount - blackKnownMateCount" << endl;
-	cout << "- variousStalemateCounts -insufficientMaterialCount: " <<
-		totalCount - illegalCount - whiteCheckmateCount - blackCheckmateCount - whiteKnownMateCount - blackKnownMateCount
-		- stalemateCount - stalemateIn1Count - stalemateIn2Count - stalemateIn3Count
-		- insufficientMaterialCount - insufficientIn1Count - insufficientIn2Count - insufficientIn3Count << endl;
-	cout << endl;
+	}
+	mReport.EndPhase(mTotalPositions, mSuccessorsVisited - successorsBefore, whiteCount + blackCount);
+}
+
+void Checkmate::GetKingPairRange(int turn, int blackKing, int whiteKing, long long& begin, long long& end)
+{
+	long long positionsPerKingPair = mTotalPositions / (2 * KING_SQUARES * KING_SQUARES);
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+	{
+		begin = (blackKing * KING_SQUARES + whiteKing) * 2 * positionsPerKingPair;
+		end = begin + 2 * positionsPerKingPair;
+	}
+	else
+	{
+		begin = ((turn * KING_SQUARES + blackKing) * KING_SQUARES + whiteKing) * positionsPerKingPair;
+		end = begin + positionsPerKingPair;
+	}
+}
+
+void Checkmate::GetTiledKingPairs(int turn, int firstBlackKing, int lastBlackKing, std::vector<int>& kingPairs)
+{
+	kingPairs.clear();
+	if (turn == (int)PIECE_COLOR::WHITE)
+	{
+		for (int blackKing = firstBlackKing; blackKing < lastBlackKing; blackKing++)
+			for (int whiteKing = 0; whiteKing < KING_SQUARES; whiteKing++)
+				kingPairs.push_back(blackKing * KING_SQUARES + whiteKing);
+	}
+	else
+	{
+		for (int whiteKing = 0; whiteKing < KING_SQUARES; whiteKing++)
+			for (int blackKing = firstBlackKing; blackKing < lastBlackKing; blackKing++)
+				kingPairs.push_back(blackKing * KING_SQUARES + whiteKing);
+	}
+}
+
+// One turn of a solver pass, KING_TILED, for kingPairs from GetTiledKingPairs.
+void Checkmate::RunSolverPassTiled(SOLVER_PASS pass, int x, int turn, const std::vector<int>& kingPairs,
+	int& whiteCount, int& blackCount, bool showProgress)
+{
+	mSolverTurn = turn;
+	for (unsigned int k = 0; k < kingPairs.size(); k++)
+	{
+		long long begin = 0;
+		long long end = 0;
+		GetKingPairRange(turn, kingPairs[k] / KING_SQUARES, kingPairs[k] % KING_SQUARES, begin, end);
+		RunSolverPassRange(pass, x, (int)begin, (int)end, whiteCount, blackCount);
+		if (showProgress && (k + 1) % KING_SQUARES == 0)
+			mReport.UpdateProgress((turn + (double)(k + 1) / kingPairs.size()) / 2);
+	}
+}
+
+// Out-of-core, goes through begin to end one block at a time, in index order, and lets go of
+// each block's part of the legal moves cache when done with it. Otherwise does it all at once.
+void Checkmate::RunSolverPassBlocks(SOLVER_PASS pass, int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	if (mOutOfCoreBlockPositions == 0)
+	{
+		RunSolverPassRange(pass, x, begin, end, whiteCount, blackCount);
+		return;
+	}
+	for (long long blockBegin = begin; blockBegin < end; blockBegin += mOutOfCoreBlockPositions)
+	{
+		int blockEnd = (int)((blockBegin + mOutOfCoreBlockPositions < end) ? blockBegin + mOutOfCoreBlockPositions : end);
+		RunSolverPassRange(pass, x, (int)blockBegin, blockEnd, whiteCount, blackCount);
+		if (mLegalMoves2) // no cache when successors are made on the fly
+			ReleaseMoveCacheRange((int)blockBegin, blockEnd, mLegalMoves2[blockEnd]);
+	}
+}
+
+// Drops positions begin up to end of mLegalMoves2, and their moves in mLegalMovesRawMemory up to rawEnd,
+// from resident memory. Only does anything out-of-core.
+void Checkmate::ReleaseMoveCacheRange(int begin, int end, long long rawEnd)
+{
+	long long rawBegin = mLegalMoves2[begin];
+	ReleaseTableMemoryRange(mLegalMoves2, begin * (long long)sizeof(long long),
+		(end - begin) * (long long)sizeof(long long), mMoveCacheMemory);
+	ReleaseTableMemoryRange(mLegalMovesRawMemory, rawBegin * (long long)sizeof(unsigned int),
+		(rawEnd - rawBegin) * (long long)sizeof(unsigned int), mMoveCacheMemory);
+}
+
+void Checkmate::RunSolverPassRange(SOLVER_PASS pass, int x, int begin, int end, int& whiteCount, int& blackCount)
+{
+	// TURN_INTERLEAVED, start at mSolverTurn's first position. The range functions go every other index from there.
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED && begin % 2 != mSolverTurn)
+		begin++;
+	switch (pass)
+	{
+	case SOLVER_PASS::MATE_IN_X:
+		IsMateInXRange(x, begin, end, whiteCount, blackCount);
+		break;
+	case SOLVER_PASS::RESPONSE_MATE_IN_X:
+		IsResponseMateInXRange(x, begin, end, whiteCount, blackCount);
+		break;
+	case SOLVER_PASS::INSUFFICIENT_IN_X:
+		CanInsufficientMaterialInXRange(x, begin, end, whiteCount, blackCount);
+		break;
+	case SOLVER_PASS::RESPONSE_INSUFFICIENT_IN_X:
+		CanResponseInsufficientMaterialInXRange(x, begin, end, whiteCount, blackCount);
+		break;
+	case SOLVER_PASS::ZEROING_IN_X:
+		IsZeroingInXRange(x, begin, end, whiteCount, blackCount);
+		break;
+	case SOLVER_PASS::RESPONSE_ZEROING_IN_X:
+		IsResponseZeroingInXRange(x, begin, end, whiteCount, blackCount);
+		break;
+	}
+}
+
+
+void Checkmate::PrintEvaluation()
+{
+	if (!mHaveStats)
+	{
+		cout << "\nGathering statistics on all data positions..." << endl;
+		mStats = GatherStatistics();
+		mHaveStats = true;
+	}
+	mStats.Print();
 
+	string filename = MakeFilenameFromPieces(mPieces) + (mStatsFormat == STATS_FORMAT::CSV ? ".stats.csv" : ".stats.json");
+	if (!mStats.Write(filename, GetSignature(), mStatsFormat))
+		cout << "Unable to write " << filename << endl;
 }
 
 // For all positions where S is some kind of illegal, set B to ILLEGAL
 // For all positions where S is INSUFFICIENT_MATERIAL or UNKNOWN, set B to UNFORCEABLE.
 // Then we don't need to save and load S, just B.
+// Every value is final once switched, so the statistics are counted here too, and PrintEvaluation
+// and SaveCombinedTable don't need another pass over the table.
 void Checkmate::SwitchMovecountValues()
 {
+	mStats.Clear();
 	for (int p = 0; p < mTotalPositions; p++)
 	{
 		if (!IsLegalPosition(p))
 			B[p] = ILLEGAL;
 		if (S[p] & INSUFFICIENT_MATERIAL || S[p] & IN_STALE_MATE || B[p]==UNKNOWN)
 			B[p] = UNFORCEABLE;
+		if (B[p] == ILLEGAL || B[p] == UNFORCEABLE)
+			Z[p] = B[p];
+		CountPosition(p, mStats);
 	}
+	mHaveStats = true;
 }
 
 string Checkmate::MakeFilenameFromPieces(const std::vector< PIECE_TYPES> & mPieces)
@@ -2092,6 +2740,8 @@ void Checkmate::SaveTable1(const std::vector< PIECE_TYPES>& mPieces)
 
 	fout.write(&B[0], mTotalPositions); 
 	fout2.write((char*)(&S[0]), mTotalPositions);
+	WriteIndexFooter(fout);
+	WriteIndexFooter(fout2);
 	fout.close();
 	fout2.close();
 	cout << "Saved the table data" << endl;
@@ -2135,6 +2785,148 @@ bool Checkmate::LoadTable1(bool printEvaluation, const std::vector< PIECE_TYPES>
 	return true;
 }
 
+// The byte for p in the combined table, from B and S.
+char Checkmate::CombinedValue(int p)
+{
+	if (!IsLegalPosition(p))
+		return ILLEGAL;
+	// Same order as PrintEvaluation: a stalemate with too little material counts as insufficient.
+	if (S[p] & INSUFFICIENT_MATERIAL)
+		return INSUFFICIENT_MATERIAL_DRAW;
+	if (S[p] & IN_STALE_MATE)
+		return STALEMATE_DRAW;
+	return B[p];
+}
+
+// As much of S as a combined table knows.
+unsigned char Checkmate::StatusFromCombinedValue(char value)
+{
+	if (value == ILLEGAL)
+		return ANY_ILLEGAL;
+	if (value == STALEMATE_DRAW)
+		return IN_STALE_MATE;
+	if (value == INSUFFICIENT_MATERIAL_DRAW)
+		return INSUFFICIENT_MATERIAL;
+	if (value == 0)
+		return IN_CHECK | IN_CHECK_MATE;
+	return START_STATUS;
+}
+
+// B gets UNFORCEABLE back for the draws. S only gets the bits StatusFromCombinedValue knows, but
+// those are all that the passes after AssignPawnPromotions read: ANY_ILLEGAL for IsLegalPosition,
+// and IN_STALE_MATE and INSUFFICIENT_MATERIAL. Illegal positions never have the draw bits.
+void Checkmate::SplitCombinedTable(char* B, unsigned char* S)
+{
+	for (int p = 0; p < mTotalPositions; p++)
+	{
+		S[p] = StatusFromCombinedValue(B[p]);
+		if (B[p] == STALEMATE_DRAW || B[p] == INSUFFICIENT_MATERIAL_DRAW)
+			B[p] = UNFORCEABLE;
+	}
+}
+
+void Checkmate::SaveCombinedTable(const std::vector< PIECE_TYPES>& mPieces)
+{
+	string filename = MakeFilenameFromPieces(mPieces) + ".combined.bin";
+	cout << "Writing the combined data to " << filename << "..." << endl;
+	ofstream fout(filename, ios::binary);
+
+	// A piece at a time, so we don't need a third big array.
+	const int bufferSize = 1 << 16;
+	char buffer[bufferSize];
+	for (long long start = 0; start < mTotalPositions; start += bufferSize)
+	{
+		int count = (int)min((long long)bufferSize, mTotalPositions - start);
+		for (int i = 0; i < count; i++)
+			buffer[i] = CombinedValue((int)(start + i));
+		fout.write(buffer, count);
+	}
+	if (mHaveStats)
+		mStats.WriteFooter(fout);
+	WriteIndexFooter(fout);
+	fout.close();
+	cout << "Saved the combined data" << endl;
+}
+
+bool Checkmate::CombinedTableExists(const std::vector< PIECE_TYPES>& mPieces)
+{
+	ifstream fin(MakeFilenameFromPieces(mPieces) + ".combined.bin", ios::binary);
+	return (bool)fin;
+}
+
+// Loads the combined table into B. Then S isn't needed.
+bool Checkmate::LoadCombinedTable(const std::vector< PIECE_TYPES>& mPieces, char* B)
+{
+	string filename = MakeFilenameFromPieces(mPieces) + ".combined.bin";
+	ifstream fin(filename, ios::binary);
+	if (!fin)
+		return false;
+	cout << "Loading the combined table data from " << filename << "..." << endl;
+	fin.read(&B[0], mTotalPositions);
+	if (fin.gcount() != mTotalPositions)
+	{
+		cout << "The combined data is too short." << endl;
+		return false;
+	}
+	fin.clear();
+	fin.seekg(0, ios::end);
+	long long end = (long long)fin.tellg();
+	if (mIndexLayout != INDEX_LAYOUT::TURN_MAJOR)
+		end -= INDEX_FOOTER_BYTES;
+	mHaveStats = mStats.ReadFooter(fin, mTotalPositions, end);
+	cout << "Successfully loaded the combined data" << endl;
+	return true;
+}
+
+void Checkmate::SaveDtzTable(const std::vector< PIECE_TYPES>& mPieces)
+{
+	string filename = MakeFilenameFromPieces(mPieces) + ".dtz.bin";
+	cout << "Writing the DTZ data to " << filename << "..." << endl;
+	ofstream fout(filename, ios::binary);
+	fout.write(&Z[0], mTotalPositions);
+	WriteIndexFooter(fout);
+	fout.close();
+	cout << "Saved the DTZ data" << endl;
+}
+
+bool Checkmate::DtzTableExists(const std::vector< PIECE_TYPES>& mPieces)
+{
+	ifstream fin(MakeFilenameFromPieces(mPieces) + ".dtz.bin", ios::binary);
+	return (bool)fin;
+}
+
+bool Checkmate::LoadDtzTable(const std::vector< PIECE_TYPES>& mPieces, char* Z)
+{
+	string filename = MakeFilenameFromPieces(mPieces) + ".dtz.bin";
+	ifstream fin(filename, ios::binary);
+	if (!fin)
+		return false;
+	cout << "Loading the DTZ data from " << filename << "..." << endl;
+	fin.read(&Z[0], mTotalPositions);
+	if (fin.gcount() != mTotalPositions)
+	{
+		cout << "The DTZ data is too short." << endl;
+		return false;
+	}
+	cout << "Successfully loaded the DTZ data" << endl;
+	return true;
+}
+
+// Writes the overflow areas of B and Z, even if they are empty, so a load knows there weren't any.
+void Checkmate::SaveOverflows(const std::vector< PIECE_TYPES>& mPieces)
+{
+	string filename = MakeFilenameFromPieces(mPieces);
+	cout << "Writing " << mBOverflow.GetEntryCount() << " and " << mZOverflow.GetEntryCount() << " overflow counts..." << endl;
+	if (!mBOverflow.Save(filename + ".table.overflow.bin") || !mZOverflow.Save(filename + ".dtz.overflow.bin"))
+		cout << "Unable to save the overflow data." << endl;
+}
+
+bool Checkmate::LoadOverflows(const std::vector< PIECE_TYPES>& mPieces, OverflowStore& bOverflow, OverflowStore& zOverflow)
+{
+	string filename = MakeFilenameFromPieces(mPieces);
+	return bOverflow.Load(filename + ".table.overflow.bin") && zOverflow.Load(filename + ".dtz.overflow.bin");
+}
+
 #if 0
 // This includes saving DEAD_POSITIONS
 void Checkmate::SaveTable2()
@@ -2268,6 +3060,8 @@ PIECE_COLOR Checkmate::GetTurnFromPosition(int p)
 	//int t = positions[0];
 	//return t;
 
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+		return (PIECE_COLOR)(p % 2);
 	int t = (int) (p / (mTotalPositions / 2));
 	return (PIECE_COLOR)t;
 }
@@ -2276,7 +3070,11 @@ PIECE_COLOR Checkmate::GetTurnFromPosition(int p)
 PIECE_COLOR Checkmate::GetExpectedWinner(const int positions[]) // returns WHITE, BLACK, or NO_COLOR
 {
 	//SymmetryConversion(i, j, k, l); done by called methods.
-	int p = ToIndex(positions);
+	return GetExpectedWinner(ToIndex(positions));
+}
+
+PIECE_COLOR Checkmate::GetExpectedWinner(int p)
+{
 //	char S = GetStatus(p);
 	char B = GetMovesToCheckmateCount(p);
 	PIECE_COLOR t = GetTurnFromPosition(p);
@@ -2284,13 +3082,12 @@ PIECE_COLOR Checkmate::GetExpectedWinner(const int positions[]) // returns WHITE
 	if (!IsLegalPosition(p))
 		return PIECE_COLOR::NO_COLOR;
 
-	if (S == NULL)
-	{
-		// If S is NULL then we loaded B, so B's UNFORCEABLE will be set.
-		if (B == UNFORCEABLE)
-			return PIECE_COLOR::NO_COLOR;
-	}
-	else
+	// A loaded B has UNFORCEABLE set, and so do the promotion positions AssignPawnPromotions
+	// copied from the promoted table, even while S is still being used.
+	// A combined table also says which draws are stalemates and insufficient material.
+	if (B == UNFORCEABLE || B == STALEMATE_DRAW || B == INSUFFICIENT_MATERIAL_DRAW)
+		return PIECE_COLOR::NO_COLOR;
+	if (S != NULL)
 	{
 		//  If S is not NULL then we can use it.
 		char s = GetStatus(p);
@@ -1,3 +1,4 @@
+#pragma once
 // This program computes Endgame Tablebases when there are 4 pieces.
 // This was first done by someone in the late 1980s.
 // In the early 1990s, the same was done for 5 pieces.
@@ -43,6 +44,11 @@
 
 #include <string>
 #include <vector>
+#include "TableMemory.h"
+#include "OverflowStore.h"
+#include "StatusPlanes.h"
+#include "BuildReport.h"
+#include "TableStats.h"
 const int DEAD_POSITION = 64;
 
 // Used for piece color and also for player turn:
@@ -91,6 +97,10 @@ struct LEGAL_MOVE
 // 1 king, 1 bishop, and 1 knight = 8+13+8=29.
 // 4 for pawn, 8 for king, 8 for knight, 13 for bishop, 14 for rook, 27 for queen
 const int MAX_LEGAL_MOVES = 8+27+25; 
+// All the moves of all the pieces of the player whose turn it is, for one position.
+const int MAX_SUCCESSORS = NUM_PIECES * MAX_LEGAL_MOVES;
+// The moves to one position: any of them can also be an un-capture of each of the other side's pieces.
+const int MAX_PREDECESSORS = MAX_SUCCESSORS * (NUM_PIECES - 1);
 
 // Status Bit field is defined as follows:
 const  unsigned char START_STATUS = 0;
@@ -131,7 +141,7 @@ const  unsigned char INSUFFICIENT_MATERIAL = 128; // Insufficient material for e
 //		B[1][i][j][k][l], value -2, means black's turn, black can mate in 2
 //		B[0][i][j][k][l], value -2, means white's turn, no matter what white does, black can mate him in 2
 //		etc.
-//		+120 or -120 for now means overflow. The answer is stored in an overflow area.
+//		+120 or -120 means 120 or more. The answer is stored in an overflow area (OverflowStore.h).
 //
 // If IN_STALE_MATE is set, B[...] must be +127. No! Not currently used!
 //
@@ -162,13 +172,118 @@ const char UNKNOWN = -128; // later becomes UNFORCEABLE
 const char ILLEGAL = -127;
 const char UNFORCEABLE = -126;
 //const char STALEMATE = 127;
-const char POSITIVE_OVERFLOW = 120; // Not used yet.
+const char POSITIVE_OVERFLOW = 120; // GetFullMovesToCheckmateCount has the real count
 const char NEGATIVE_OVERFLOW = -120;
 
+// The combined table (<name>.combined.bin) is B and the parts of S that probes need, in one byte
+// per position. It is what is saved, with the DTZ table, and loaded instead of the table and
+// status files (SetLegacyTableFiles) when it is there, so only one array is read and kept in memory.
+//		-120 to 120 mean the same as in B, overflows included, with 0 meaning the player whose turn it is is in checkmate.
+//		ILLEGAL and UNFORCEABLE mean the same as in B, except that UNFORCEABLE is now only used for
+//		draws that are neither of these:
+const char STALEMATE_DRAW = -125; // IN_STALE_MATE. The player whose turn it is is in stalemate.
+const char INSUFFICIENT_MATERIAL_DRAW = -124; // INSUFFICIENT_MATERIAL, now or forced.
+// GetStatus on a combined table can't say why a position is illegal, so it gives all of these:
+const unsigned char ANY_ILLEGAL = KINGS_ADJACENT | ON_TOP | BAD_CHECK | BAD_PAWN;
+// After the positions come the table's statistics, so loading it needs no pass to count them
+// (TABLE_STATS::WriteFooter). Older combined tables end with the positions.
+
+// Z is the depth to zeroing table (<name>.dtz.bin), for the fifty move rule. It is how many moves
+// the winner needs to make a capture, a pawn move or checkmate, with the loser putting that off
+// as long as it can. Positive if White wins, negative if Black wins, like B. Zero means the loser
+// is to move and every move it has is a capture or a pawn move, or it is checkmated.
+// ILLEGAL and UNFORCEABLE are the same as in B.
+// A win with a Z of FIFTY_MOVE_RULE or less can be made before a fifty move rule draw.
+const int FIFTY_MOVE_RULE = 50;
+
 const int KING_SQUARES = 64;
 const int OTHER_SQUARES = 65;
 //const int TOTAL_POSITIONS = 2 * KING_SQUARES * KING_SQUARES * OTHER_SQUARES * OTHER_SQUARES;
 const int AVERAGE_MOVES_PER_POSITION = 14;
+// Out-of-core, about how many bytes of mLegalMoves2 and mLegalMovesRawMemory each position streams through.
+const int OUT_OF_CORE_BYTES_PER_POSITION = sizeof(long long) + AVERAGE_MOVES_PER_POSITION * sizeof(unsigned int);
+
+// Saved tables are tagged with these, so the BuildScheduler knows when a table must be made again.
+// Increase GENERATOR_VERSION whenever a change would make different table or status bytes,
+// or different output files.
+// Increase INDEX_SCHEME whenever ToIndex/FromIndex change.
+const int GENERATOR_VERSION = 5; // 2: also saves the combined table. 3: and the DTZ table. 4: and overflows. 5: statistics footer on the combined table
+const int INDEX_SCHEME = 1;
+
+// The order of the turn and the squares in an index (see ToIndex).
+//	TURN_MAJOR: turn, black king, white king, then the other pieces. INDEX_SCHEME.
+//		Every successor is in the other half of the table, mTotalPositions / 2 away or more.
+//	TURN_INTERLEAVED: black king, white king, the other pieces, then the turn. INDEX_SCHEME_INTERLEAVED.
+//		A position and its successors are next to each other when the last piece moves, and
+//		a few hundred bytes apart for the piece before it, so fewer successor reads should miss
+//		the caches and the TLB. Only king moves still go far. Solver passes still do all of
+//		White's turn before Black's, going through the table twice, every other index.
+//		-benchmark=layouts measures which is faster.
+// Tables made with TURN_INTERLEAVED end every saved file with INDEX_FOOTER_MAGIC after the positions
+// (and after the combined table's statistics), and loading finds it there. Files without it are TURN_MAJOR.
+// Tables made from others (pawn promotions) need the same layout as those.
+enum class INDEX_LAYOUT { TURN_MAJOR, TURN_INTERLEAVED };
+const int INDEX_LAYOUT_COUNT = 2;
+const char gIndexLayoutNames[INDEX_LAYOUT_COUNT][20] = { "turn major", "turn interleaved" };
+const int INDEX_SCHEME_INTERLEAVED = 2;
+// The footer is the scheme as a long long, a long long 1 (how many long longs came before), and this.
+const char INDEX_FOOTER_MAGIC[9] = "INDEX001";
+const int INDEX_FOOTER_BYTES = 2 * sizeof(long long) + 8;
+
+// The passes that find "Mate In X", "Insufficient Material In X" and "Zeroing In X" positions.
+enum class SOLVER_PASS {
+		MATE_IN_X, RESPONSE_MATE_IN_X, INSUFFICIENT_IN_X, RESPONSE_INSUFFICIENT_IN_X,
+		ZEROING_IN_X, RESPONSE_ZEROING_IN_X};
+const char gSolverPassNames[6][40] = {
+		"IsMateInX", "IsResponseMateInX", "CanInsufficientMaterialInX", "CanResponseInsufficientMaterialInX",
+		"IsZeroingInX", "IsResponseZeroingInX"};
+// Without partition workers, a solver pass goes through the table in this many pieces, to show progress.
+const int SOLVER_PROGRESS_STEPS = 64;
+
+// The order a solver pass goes through one turn's positions (see RunSolverPass).
+//	LINEAR: index order.
+//	KING_TILED: a king pair at a time, all of its positions, with the king of the side to move
+//		innermost. A king pair's king-move successors are the other turn's king pairs next to it, so
+//		the king pairs after it read mostly the same ones, about three rows of the board of them,
+//		while they are still in the L2 or L3 cache. In index order, the black king is outermost,
+//		so Black's king moves go to king pairs that were last read a whole white king sweep before,
+//		up to nine times each. White to move, KING_TILED is index order.
+// Out-of-core, passes are always LINEAR, to go through the blocks in order.
+// LINEAR is the default, since -benchmark=order hasn't shown KING_TILED to be faster yet.
+enum class SOLVER_ORDER { LINEAR, KING_TILED };
+const int SOLVER_ORDER_COUNT = 2;
+const char gSolverOrderNames[SOLVER_ORDER_COUNT][12] = { "linear", "king tiled" };
+// With the legal moves cache, the solver passes prefetch the successors' B and S (or Z) of the
+// position this many positions ahead, so those reads are on their way while the positions
+// before it are solved, instead of each waiting on its own cache miss.
+// Off by default (SetSolverPrefetch), since -benchmark=prefetch has only shown it slower so far.
+const int SOLVER_PREFETCH_DISTANCE = 8;
+// With SetStatusPlanes, IsLegalPosition tests one bit of a plane of ANY_ILLEGAL (StatusPlanes.h), an
+// eighth the size of S, instead of S, once all the illegal bits are set. Promotions copy them from
+// the promoted table, so the plane is gathered again after each AssignPawnPromotions.
+// Off by default, since -benchmark=planes hasn't shown it to be faster yet.
+const int ILLEGAL_PLANE = 0;
+const int STATUS_PLANE_COUNT = 1;
+
+// What VerifyTable can find wrong with a position (TableVerifier.cpp). The ZEROING_ ones are about Z.
+enum class TABLE_VIOLATION {
+		NONE, ILLEGAL_MISMATCH, UNKNOWN_LEFT, NO_MOVES_NOT_ENDED, MATE_WITH_MOVES, STALEMATE_WITH_MOVES,
+		WIN_WITHOUT_STEP, WIN_NOT_SHORTEST, LOSS_WITH_ESCAPE, LOSS_NOT_LONGEST, DRAW_WITH_WIN, DRAW_ALL_LOST,
+		ZEROING_ON_DRAW, ZEROING_UNKNOWN, ZEROING_WRONG_SIDE, ZEROING_WITHOUT_STEP, ZEROING_NOT_SHORTEST,
+		ZEROING_LOSS_LONGER, ZEROING_LOSS_NOT_LONGEST};
+const int TABLE_VIOLATION_KINDS = 19;
+const char gTableViolationNames[TABLE_VIOLATION_KINDS][60] = {
+		"none", "illegal or not, wrongly", "still unknown", "no moves, but not mate or draw",
+		"mate with moves", "stalemate with moves",
+		"win with no move to one less", "win with a faster move", "loss with a move that doesn't lose",
+		"loss with no move to the same count", "draw with a winning move", "draw where every move loses",
+		"draw or illegal with a zeroing count", "win or loss with no zeroing count",
+		"zeroing count for the wrong side", "win with no zeroing move or move to one less",
+		"win with a faster zeroing move", "loss that can put off zeroing longer",
+		"loss with no move to the same zeroing count"};
+// Violating positions kept by each verifier thread. The counts include all of them.
+const int VERIFY_MAX_KEPT = 100000;
+const int VERIFY_MAX_PRINTED = 20;
 
 class Checkmate
 {
@@ -180,18 +295,98 @@ public:
 	void AllocateMemory(bool loadData, bool printEvaluation);
 	~Checkmate();
 
+	// With 2 or more workers, the solver passes run in that many child processes, each owning a
+	// range of black king squares, all sharing B and S. Call before Initialize. Not on Windows.
+	void SetPartitionWorkers(int workers) { mPartitionWorkers = workers; }
+	int mPartitionWorkers;
+	TABLE_MEMORY mTableMemory; // how B and S were allocated
+	TABLE_MEMORY mMoveCacheMemory; // how mLegalMovesRawMemory and mLegalMoves2 were allocated
+
+	// Out-of-core generation, for tables bigger than memory. Call before Initialize.
+	// B, S and the legal moves cache become scratch files in directory, mapped into memory.
+	// The solver passes go through them in blocks, keeping about residentBytes of the legal moves
+	// cache in memory. B, S and Z are not released: successors are read from anywhere in them, and
+	// their changed pages go back to the files whenever the operating system writes them, so they
+	// need memory of their own, which the memory planner counts in full.
+	// Only used if the table doesn't fit in memory otherwise (see SetMemoryBudget).
+	void SetOutOfCore(const std::string& directory, long long residentBytes);
+	std::string mOutOfCoreDirectory; // empty unless out-of-core
+	long long mOutOfCoreResidentBytes;
+	long long mOutOfCoreBlockPositions; // zero unless out-of-core
+	void* AllocateArray(const char* name, long long bytes, TABLE_MEMORY kind);
+	void ReleaseMoveCacheRange(int begin, int end, long long rawEnd);
+
+	// Without the legal moves cache, the solver passes make each position's successors again
+	// every time they need them, with GenerateSuccessors, the same GatherLegalMovesForPiece path
+	// that fills the cache. That is 3.5 to 5 times slower (-benchmark=successors), but only B, S
+	// and Z are needed. Call before Initialize.
+	void SetOnTheFlySuccessors(bool onTheFly) { mOnTheFlySuccessors = onTheFly; }
+	bool mOnTheFlySuccessors;
+	long long GetTableMemoryBytes(); // what AllocateMemory got
+
+	// Initialize asks the MemoryPlanner how to make the table within this many bytes.
+	// Zero means all the memory there is (GetAvailableMemory). Call before Initialize.
+	// SetOnTheFlySuccessors(true) rules out the move cache strategies,
+	// and SetOutOfCore lets the planner use out-of-core if nothing else fits.
+	void SetMemoryBudget(long long bytes) { mMemoryBudget = bytes; }
+	long long mMemoryBudget;
+	long long mPlannedMoveCacheEntries; // zero until planned
+	void ChooseGenerationStrategy();
+
+	// Huge pages and NUMA placement for the big arrays (see TableMemory.h). Call before Initialize.
+	void SetHugePages(HUGE_PAGES hugePages) { mHugePages = hugePages; }
+	void SetNumaPolicy(NUMA_POLICY numaPolicy) { mNumaPolicy = numaPolicy; }
+	HUGE_PAGES mHugePages;
+	NUMA_POLICY mNumaPolicy;
+	void ReportPageSizes();
+	void BindPartitionToNumaNode(int worker, int workers, int node);
+
+	// Times every phase of Initialize, and writes <name>.report.json (see BuildReport.h).
+	BuildReport mReport;
+	void SetShowProgress(bool showProgress) { mReport.SetShowProgress(showProgress); }
+	// Hardware counters for each phase in the report, when there are any. See PerfCounters.h.
+	void SetPerfCounters(bool usePerfCounters) { mReport.SetPerfCounters(usePerfCounters); }
+	long long mSuccessorsVisited; // read by the solver passes so far
+	std::string GetSignature(); // the file name without the directory
+
 	long long mTotalPositions; // long long is 8 bytes. Really only need a 4 bytes unsigned int for 5 pieces or less.
 	// B represents all the board positions. Use FromIndex and ToIndex for Turn and Individual pieces.
 	//		Note that the last pieces (non kings) can be at position 64, which means DEAD
 	char* B; // mTotalPositions, dynamic
 	// S represents the status bits for all the board positions. (see the above header file)
 	unsigned char* S; // mTotalPositions, dynamic
+	// Z is the depth to zeroing for all the board positions. (see the above header file)
+	char* Z; // mTotalPositions, dynamic. NULL when loading a table that has no DTZ file.
+	// The real counts where B or Z is POSITIVE_OVERFLOW or NEGATIVE_OVERFLOW.
+	OverflowStore mBOverflow;
+	OverflowStore mZOverflow;
+	void SetMovesToCheckmateCount(int p, int count) // for any count, even 120 or more
+	{
+		if (count < POSITIVE_OVERFLOW && count > NEGATIVE_OVERFLOW)
+			B[p] = (char)count;
+		else
+			SetOverflowCount(B, mBOverflow, p, count);
+	}
+	void SetMovesToZeroingCount(int p, int count)
+	{
+		if (count < POSITIVE_OVERFLOW && count > NEGATIVE_OVERFLOW)
+			Z[p] = (char)count;
+		else
+			SetOverflowCount(Z, mZOverflow, p, count);
+	}
+	void SetOverflowCount(char* table, OverflowStore& overflow, int p, int count);
+	static bool IsOverflow(char count) { return count == POSITIVE_OVERFLOW || count == NEGATIVE_OVERFLOW; }
 
 	// for indexing into B and S arrays:
 	void FromIndex(int index, std::vector<int>& positions);
 	void FromIndex(int index, int positons[]);
 	int ToIndex(const std::vector<int>& positions);
 	int ToIndex(const int positons[]);
+	INDEX_LAYOUT mIndexLayout;
+	void SetIndexLayout(INDEX_LAYOUT layout) { mIndexLayout = layout; } // before Initialize
+	int GetIndexScheme(); // INDEX_SCHEME or INDEX_SCHEME_INTERLEAVED
+	void WriteIndexFooter(std::ostream& out); // if the layout needs one
+	INDEX_LAYOUT ReadIndexLayout(const std::vector< PIECE_TYPES>& mPieces); // of the saved table
 
 	long long mLegalMovesRawMemoryRequested;
 	unsigned int* mLegalMovesRawMemory; // mLegalMovesRawMemoryRequested, dynamic
@@ -232,6 +427,9 @@ public:
 		int promotionRow);
 	void CacheAllLegalMovesForAllPositions();  // Call this to make the cache
 	void CacheAllLegalMovesForThisPosition(int p);
+	int GenerateSuccessors(int p, unsigned int successors[MAX_SUCCESSORS]); // returns how many
+	// Points at the cached successors of p, or makes them in buffer if there is no cache.
+	const unsigned int* GetSuccessors(int p, unsigned int buffer[MAX_SUCCESSORS], int& count);
 	PIECE_COLOR GetColor(PIECE_TYPES pt); // returns WHITE, BLACK, or NO_COLOR for NONE slots.
 	int ToReplaceIndex(const int oldPositions[],
 		int pieceIndex, int newPiecePosition);
@@ -270,25 +468,131 @@ public:
 
 	int IsMateInX(int x);
 	int IsResponseMateInX(int x);
+	void IsMateInXRange(int x, int begin, int end, int& whiteCount, int& blackCount);
+	void IsResponseMateInXRange(int x, int begin, int end, int& whiteCount, int& blackCount);
 	char GetMovesToCheckmateCount(const int positions[]); // See above chart. BSFIX check for return values of UNKNOWN and UNFORCEABLE
 	char GetMovesToCheckmateCount(int p);
+	// Like GetMovesToCheckmateCount, but with the real count where that says POSITIVE_OVERFLOW or
+	// NEGATIVE_OVERFLOW. Check for UNKNOWN, ILLEGAL and UNFORCEABLE with GetMovesToCheckmateCount,
+	// because a count of -126 or less looks like them.
+	int GetFullMovesToCheckmateCount(const int positions[]);
+	int GetFullMovesToCheckmateCount(int p);
 	unsigned char GetStatus(const int positions[]);
 	unsigned char GetStatus(int p);
+	// x2 gets the full counts, with the overflows looked up, so it can't be told from UNKNOWN
+	// by value: moves to UNKNOWN and UNFORCEABLE positions are left out instead.
 	bool GetLegalMovesMetrics(int position, // call this to retrieve part of the legal moves cache
-		char s2[], char x2[], int& moveCount, bool breakOnUnknownExists = false);
+		char s2[], int x2[], int& moveCount, bool breakOnUnknownExists = false);
 
 	int CanInsufficientMaterialInX(int x);
 	int CanResponseInsufficientMaterialInX(int x);
-
-	void PrintEvaluation(); // Prints everything about B and S
+	void CanInsufficientMaterialInXRange(int x, int begin, int end, int& whiteCount, int& blackCount);
+	void CanResponseInsufficientMaterialInXRange(int x, int begin, int end, int& whiteCount, int& blackCount);
+
+	// Depth to zeroing. Call after the Mate In X and Insufficient Material In X passes.
+	int IsZeroingInX(int x);
+	int IsResponseZeroingInX(int x);
+	void IsZeroingInXRange(int x, int begin, int end, int& whiteCount, int& blackCount);
+	void IsResponseZeroingInXRange(int x, int begin, int end, int& whiteCount, int& blackCount);
+	bool IsZeroingMove(const int positions[], int newIndex); // a capture or a pawn move
+	void ReportFiftyMoveRule();
+	char GetMovesToZeroingCount(const int positions[]); // UNKNOWN if there is no DTZ data
+	char GetMovesToZeroingCount(int p);
+	int GetFullMovesToZeroingCount(int p);
+
+	// Every pass only writes positions of one turn and only reads positions of the other turn.
+	// So all of White's turn positions can be done in any order, then all of Black's,
+	// and the results are exactly the same as one pass in index order.
+	void RunSolverPass(SOLVER_PASS pass, int x, int& whiteCount, int& blackCount);
+	void RunSolverPassRange(SOLVER_PASS pass, int x, int begin, int end, int& whiteCount, int& blackCount);
+	void RunSolverPassBlocks(SOLVER_PASS pass, int x, int begin, int end, int& whiteCount, int& blackCount);
+	// TURN_INTERLEAVED, the turn whose positions the solver pass ranges go through, every other index.
+	int mSolverTurn;
+	int GetSolverStride() { return (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED) ? 2 : 1; }
+	SOLVER_ORDER mSolverOrder;
+	void SetSolverOrder(SOLVER_ORDER order) { mSolverOrder = order; }
+	// The positions of turn with those kings, begin up to end, for RunSolverPassRange.
+	void GetKingPairRange(int turn, int blackKing, int whiteKing, long long& begin, long long& end);
+	// The king pairs (black king * KING_SQUARES + white king) with black kings firstBlackKing up to
+	// lastBlackKing, in the order KING_TILED goes through them for turn.
+	void GetTiledKingPairs(int turn, int firstBlackKing, int lastBlackKing, std::vector<int>& kingPairs);
+	void RunSolverPassTiled(SOLVER_PASS pass, int x, int turn, const std::vector<int>& kingPairs,
+		int& whiteCount, int& blackCount, bool showProgress);
+	// A partition worker's king pairs for each turn, made before it is forked, since it can't allocate.
+	std::vector<int> mTiledKingPairs[2];
+	bool mSolverPrefetch;
+	void SetSolverPrefetch(bool prefetch) { mSolverPrefetch = prefetch; }
+	// See SOLVER_PREFETCH_DISTANCE. Only if p is still UNKNOWN in B (or Z, for zeroing), since the
+	// passes skip the others.
+	void PrefetchSuccessors(int p, bool zeroing);
+	StatusPlanes mStatusPlanes;
+	bool mUseStatusPlanes;
+	bool mStatusPlanesReady; // false until S's illegal bits are all set
+	void SetStatusPlanes(bool useStatusPlanes) { mUseStatusPlanes = useStatusPlanes; }
+	void UpdateStatusPlanes();
+
+	// Multi-process solving (PartitionedSolver.cpp):
+	void StartPartitionWorkers();
+	void StopPartitionWorkers();
+	void RunPartitionedSolverPass(SOLVER_PASS pass, int x, int& whiteCount, int& blackCount);
+	void PartitionWorkerLoop(int worker, int commandFd, int resultFd);
+	void GetPartitionRange(int worker, int workers, int turn, long long& begin, long long& end);
+	std::vector<int> mPartitionWorkerIds; // process ids. Empty unless the workers are running.
+	std::vector<int> mPartitionCommandFds;
+	std::vector<int> mPartitionResultFds;
+
+	// Checks every position of a loaded or made table against its successors, made again with
+	// GenerateSuccessors, on threads threads (TableVerifier.cpp). Returns false if any don't agree.
+	bool VerifyTable(int threads);
+	TABLE_VIOLATION VerifyPosition(int p);
+	TABLE_VIOLATION VerifyZeroing(int p); // Z, once VerifyPosition found B right
+	bool IsPromotionPosition(const int positions[]); // B and S came from the promoted table
+
+	// The positions whose successors include q, going backward from q (Predecessors.cpp).
+	int GeneratePredecessors(int q, unsigned int predecessors[MAX_PREDECESSORS]); // returns how many
+	void GatherUnmoves(const int positions[], LEGAL_MOVE unmoves[MAX_PREDECESSORS], int& unmoveCount);
+	void AddUnmoves(int pieceIndex, int origin, bool quiet, bool capture, const int positions[],
+		LEGAL_MOVE unmoves[MAX_PREDECESSORS], int& unmoveCount);
+	int UnmoveIndex(const int positions[], const LEGAL_MOVE& unmove); // the position before unmove
+	// Checks GeneratePredecessors against GenerateSuccessors for every position, on threads threads.
+	bool CheckPredecessors(int threads);
+
+	void PrintEvaluation(); // Prints everything about B and S, and writes <name>.stats.json or .csv
+	// Counts every position, on mStatsThreads threads (all of them if 0). See TableStats.h.
+	TABLE_STATS GatherStatistics();
+	void CountPosition(int p, TABLE_STATS& stats);
+	void SetStatsThreads(int threads) { mStatsThreads = threads; }
+	void SetStatsFormat(STATS_FORMAT format) { mStatsFormat = format; }
+	int mStatsThreads;
+	STATS_FORMAT mStatsFormat;
+	// Counted by SwitchMovecountValues, or read from the footer of a combined table.
+	TABLE_STATS mStats;
+	bool mHaveStats;
 	void PrintPosition(const int position[]); // prints one position
 
 	// Saving and Loading B and S:
+	// A table is saved as its .combined.bin and .dtz.bin files. The .table.bin and .status.bin
+	// files of B and S as they are are only saved with SetLegacyTableFiles, for TableDiff -status and
+	// the golden tables. Loading, and promotions, use the combined table when there is one.
+	bool mLegacyTableFiles;
+	void SetLegacyTableFiles(bool legacyTableFiles) { mLegacyTableFiles = legacyTableFiles; }
 	void SwitchMovecountValues();
 	std::string MakeFilenameFromPieces(const std::vector< PIECE_TYPES>& mPieces);
 	void SaveTable1(const std::vector< PIECE_TYPES>& mPieces);
 	bool LoadTable1(bool printEvaluation, const std::vector< PIECE_TYPES>& mPieces, 
 			char* B, unsigned char* S);
+	char CombinedValue(int p); // call after SwitchMovecountValues
+	static unsigned char StatusFromCombinedValue(char value);
+	// A loaded combined table back to B and S, the way SwitchMovecountValues left them.
+	void SplitCombinedTable(char* B, unsigned char* S);
+	void SaveCombinedTable(const std::vector< PIECE_TYPES>& mPieces);
+	bool CombinedTableExists(const std::vector< PIECE_TYPES>& mPieces);
+	bool LoadCombinedTable(const std::vector< PIECE_TYPES>& mPieces, char* B);
+	void SaveDtzTable(const std::vector< PIECE_TYPES>& mPieces);
+	bool DtzTableExists(const std::vector< PIECE_TYPES>& mPieces);
+	bool LoadDtzTable(const std::vector< PIECE_TYPES>& mPieces, char* Z);
+	void SaveOverflows(const std::vector< PIECE_TYPES>& mPieces);
+	bool LoadOverflows(const std::vector< PIECE_TYPES>& mPieces, OverflowStore& bOverflow, OverflowStore& zOverflow);
 //	void SaveTable2();
 //	bool LoadTable2();
 
@@ -299,6 +603,7 @@ public:
 
 	// Called only externally.
 	PIECE_COLOR GetExpectedWinner(const int positions[]); // returns WHITE, BLACK, or NO_COLOR for drawish. 
+	PIECE_COLOR GetExpectedWinner(int p);
 	void CalculateLegalMovesPositions(const int positions[],
 		LEGAL_MOVE allLegalMoves[MAX_LEGAL_MOVES], int& legalMoveCount); // Does not use legal move cache.
 	void GenerateNewPositionFromLegalMove(const int positions1[], const LEGAL_MOVE& lm,
@@ -0,0 +1,437 @@
+/*
+Golden table regression.
+
+The checked in WQ, WR, WB, WN, BQ and BP tables are older than two changes to the generator:
+	SwitchMovecountValues, at the end of Initialize, makes every UNKNOWN, stalemate and
+		insufficient material position that isn't ILLEGAL UNFORCEABLE. The checked in B still has
+		UNKNOWN there, or 0 for stalemates.
+	BAD_PAWN took status bit 8, moving the bits above it up one. The checked in WQ, WR, WB and WN
+		status files are from before then. BQ and BP already have it.
+ConvertLegacyTable undoes both, and anything else that differs is a real difference.
+*/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "GoldenTables.h"
+#include "BuildCache.h"
+#include "BuildScheduler.h"
+#include "MemoryPlanner.h"
+
+struct GOLDEN_HASHES
+{
+	unsigned long long table;
+	unsigned long long status;
+	unsigned long long combined;
+	unsigned long long dtz;
+	unsigned long long overflows; // .table.overflow.bin, then .dtz.overflow.bin
+};
+
+// The files each golden build makes, besides .table.bin and .status.bin, deleted after the run.
+// A .verify.txt is kept, since it is only there when the verifier found something.
+const int GOLDEN_MADE_FILE_COUNT = 7;
+const char gGoldenMadeFiles[GOLDEN_MADE_FILE_COUNT][24] = {
+		".combined.bin", ".dtz.bin", ".table.overflow.bin", ".dtz.overflow.bin",
+		".report.json", ".stats.json", ".stats.csv"};
+
+static bool SameHashes(const GOLDEN_HASHES& a, const GOLDEN_HASHES& b)
+{
+	return a.table == b.table && a.status == b.status && a.combined == b.combined &&
+		a.dtz == b.dtz && a.overflows == b.overflows;
+}
+
+static bool ReadWholeFile(const string& filename, vector<char>& bytes)
+{
+	ifstream fin(filename, ios::binary);
+	if (!fin)
+		return false;
+	bytes.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+	return true;
+}
+
+static bool WriteWholeFile(const string& filename, const vector<char>& bytes)
+{
+	ofstream fout(filename, ios::binary);
+	fout.write(bytes.data(), bytes.size());
+	return (bool)fout;
+}
+
+// A table file of layout with its positions in turn major order, and without the index footer,
+// so it is byte for byte what a TURN_MAJOR build saves.
+static bool ReadTurnMajorFile(const string& filename, long long totalPositions, INDEX_LAYOUT layout, vector<char>& bytes)
+{
+	if (!ReadWholeFile(filename, bytes))
+		return false;
+	if (layout == INDEX_LAYOUT::TURN_MAJOR)
+		return true;
+	if ((long long)bytes.size() < totalPositions + INDEX_FOOTER_BYTES)
+		return false;
+	bytes.resize(bytes.size() - INDEX_FOOTER_BYTES);
+	vector<char> file = bytes;
+	Checkmate majorIndex;
+	Checkmate layoutIndex;
+	majorIndex.SetIndexLayout(INDEX_LAYOUT::TURN_MAJOR);
+	layoutIndex.SetIndexLayout(layout);
+	int positions[POSITION_ARRAY_SIZE];
+	for (int i = 0; i < totalPositions; i++)
+	{
+		majorIndex.FromIndex(i, positions);
+		bytes[i] = file[layoutIndex.ToIndex(positions)];
+	}
+	return true;
+}
+
+static bool HashTurnMajorFile(const string& filename, long long totalPositions, INDEX_LAYOUT layout, unsigned long long& hash)
+{
+	vector<char> bytes;
+	if (!ReadTurnMajorFile(filename, totalPositions, layout, bytes))
+		return false;
+	hash = HashBytes(bytes.data(), (long long)bytes.size());
+	return true;
+}
+
+// The overflow files of a table of layout, with their positions in turn major order, hashed
+// together, so they hash the same as a TURN_MAJOR build's.
+static bool HashTurnMajorOverflows(const string& filename, INDEX_LAYOUT layout, unsigned long long& hash)
+{
+	Checkmate majorIndex;
+	Checkmate layoutIndex;
+	majorIndex.SetIndexLayout(INDEX_LAYOUT::TURN_MAJOR);
+	layoutIndex.SetIndexLayout(layout);
+	vector<char> bytes;
+	const char* suffixes[2] = { ".table.overflow.bin", ".dtz.overflow.bin" };
+	for (int f = 0; f < 2; f++)
+	{
+		vector<char> file;
+		if (!ReadWholeFile(filename + suffixes[f], file) || file.size() < sizeof(long long))
+			return false;
+		long long count = 0;
+		memcpy(&count, file.data(), sizeof(count));
+		if ((long long)file.size() != sizeof(count) + count * (long long)sizeof(OVERFLOW_ENTRY))
+			return false;
+		vector<OVERFLOW_ENTRY> entries((size_t)count);
+		if (count)
+			memcpy(&entries[0], file.data() + sizeof(count), count * sizeof(OVERFLOW_ENTRY));
+		if (layout != INDEX_LAYOUT::TURN_MAJOR)
+		{
+			int positions[POSITION_ARRAY_SIZE];
+			for (unsigned int e = 0; e < entries.size(); e++)
+			{
+				layoutIndex.FromIndex(entries[e].position, positions);
+				entries[e].position = majorIndex.ToIndex(positions);
+			}
+			sort(entries.begin(), entries.end(),
+				[](const OVERFLOW_ENTRY& a, const OVERFLOW_ENTRY& b) { return a.position < b.position; });
+		}
+		bytes.insert(bytes.end(), file.begin(), file.begin() + sizeof(count));
+		if (count)
+			bytes.insert(bytes.end(), (const char*)&entries[0], (const char*)&entries[0] + count * sizeof(OVERFLOW_ENTRY));
+	}
+	hash = HashBytes(bytes.data(), (long long)bytes.size());
+	return true;
+}
+
+// Status with BAD_PAWN moved into bit 8, the way it is now.
+static unsigned char AddBadPawnBit(unsigned char status)
+{
+	return (unsigned char)((status & (KINGS_ADJACENT | ON_TOP | BAD_CHECK)) | ((status & ~(KINGS_ADJACENT | ON_TOP | BAD_CHECK)) << 1));
+}
+
+// Converts a checked in table to what the generator makes now. currentStatus, the status the
+// generator made, is only used to tell which status layout the file has.
+// Returns false if the status is neither layout.
+static bool ConvertLegacyTable(vector<char>& table, vector<char>& status, const vector<char>& currentStatus)
+{
+	if (status.size() != currentStatus.size())
+		return false;
+	if (status != currentStatus)
+	{
+		vector<char> moved(status.size());
+		for (unsigned int i = 0; i < status.size(); i++)
+			moved[i] = (char)AddBadPawnBit((unsigned char)status[i]);
+		if (moved != currentStatus)
+			return false;
+		status = moved;
+	}
+	for (unsigned int i = 0; i < table.size() && i < status.size(); i++)
+	{
+		unsigned char s = (unsigned char)status[i];
+		if (table[i] != ILLEGAL && (table[i] == UNKNOWN || (s & (IN_STALE_MATE | INSUFFICIENT_MATERIAL))))
+			table[i] = UNFORCEABLE;
+	}
+	return true;
+}
+
+// Prints the first position where a and b differ, and how many do. Returns true if none do.
+static bool CompareBytes(Checkmate& checkmate, const string& what, const vector<char>& a, const vector<char>& b)
+{
+	if (a.size() != b.size())
+	{
+		cout << "  " << what << ": " << a.size() << " bytes, not " << b.size() << endl;
+		return false;
+	}
+	long long differences = 0;
+	int first = -1;
+	for (unsigned int i = 0; i < a.size(); i++)
+	{
+		if (a[i] != b[i])
+		{
+			if (first < 0)
+				first = i;
+			differences++;
+		}
+	}
+	if (differences == 0)
+		return true;
+	int positions[POSITION_ARRAY_SIZE];
+	checkmate.FromIndex(first, positions);
+	cout << "  " << what << ": " << differences << " positions differ. The first is " << first
+		<< " (" << (int)a[first] << ", not " << (int)b[first] << "): ";
+	checkmate.PrintPosition(positions);
+	return false;
+}
+
+static string GoldenFilename()
+{
+	return NUM_PIECES == 3 ? "..\\MakeTables\\golden.txt" : "..\\MakeTables\\golden4.txt";
+}
+
+// The golden tables of this build's NUM_PIECES, in the order they are made.
+static vector<string> GoldenSignatures()
+{
+	vector<string> signatures;
+	if (NUM_PIECES == 3)
+		signatures.assign(gGoldenTables, gGoldenTables + GOLDEN_TABLE_COUNT);
+	else if (NUM_PIECES == 4)
+		signatures.assign(gGoldenTwoPawnTables, gGoldenTwoPawnTables + GOLDEN_TWO_PAWN_TABLE_COUNT);
+	return signatures;
+}
+
+// golden.txt has a line for each table: signature, then the table, status, combined, dtz and
+// overflows hashes.
+static bool ReadGoldenHashes(const vector<string>& signatures, vector<GOLDEN_HASHES>& hashes)
+{
+	ifstream fin(GoldenFilename());
+	if (!fin)
+		return false;
+	hashes.assign(signatures.size(), GOLDEN_HASHES());
+	vector<bool> found(signatures.size(), false);
+	string signature;
+	GOLDEN_HASHES line;
+	while (fin >> signature >> hex >> line.table >> line.status >> line.combined >> line.dtz >> line.overflows >> dec)
+	{
+		for (unsigned int t = 0; t < signatures.size(); t++)
+		{
+			if (signature == signatures[t])
+			{
+				hashes[t] = line;
+				found[t] = true;
+			}
+		}
+	}
+	for (unsigned int t = 0; t < signatures.size(); t++)
+		if (!found[t])
+			return false;
+	return true;
+}
+
+static bool WriteGoldenHashes(const vector<string>& signatures, const vector<GOLDEN_HASHES>& hashes)
+{
+	ofstream fout(GoldenFilename());
+	for (unsigned int t = 0; t < signatures.size(); t++)
+	{
+		fout << signatures[t] << hex << setfill('0')
+			<< " " << setw(16) << hashes[t].table
+			<< " " << setw(16) << hashes[t].status
+			<< " " << setw(16) << hashes[t].combined
+			<< " " << setw(16) << hashes[t].dtz
+			<< " " << setw(16) << hashes[t].overflows << dec << setfill(' ') << endl;
+	}
+	return (bool)fout;
+}
+
+static void MakeTable(Checkmate& checkmate, const vector< PIECE_TYPES>& pieces, GOLDEN_MODE mode)
+{
+	switch (mode)
+	{
+	case GOLDEN_MODE::SERIAL:
+		break;
+	case GOLDEN_MODE::PARTITIONED:
+		checkmate.SetPartitionWorkers(GOLDEN_PARTITION_WORKERS);
+		break;
+	case GOLDEN_MODE::NO_MOVE_CACHE:
+		checkmate.SetOnTheFlySuccessors(true);
+		break;
+	case GOLDEN_MODE::OUT_OF_CORE:
+	{
+		long long residentBytes = NUM_PIECES == 3 ? GOLDEN_RESIDENT_BYTES : GOLDEN_TWO_PAWN_RESIDENT_BYTES;
+		checkmate.SetMemoryBudget(residentBytes);
+		checkmate.SetOutOfCore(".", residentBytes);
+		break;
+	}
+	case GOLDEN_MODE::HUGE_PAGES_NUMA:
+		checkmate.SetHugePages(HUGE_PAGES::TRANSPARENT);
+		checkmate.SetNumaPolicy(NUMA_POLICY::INTERLEAVE);
+		break;
+	case GOLDEN_MODE::TURN_INTERLEAVED:
+		checkmate.SetIndexLayout(INDEX_LAYOUT::TURN_INTERLEAVED);
+		break;
+	case GOLDEN_MODE::KING_TILED:
+		checkmate.SetSolverOrder(SOLVER_ORDER::KING_TILED);
+		break;
+	case GOLDEN_MODE::PREFETCH:
+		checkmate.SetSolverPrefetch(true);
+		break;
+	case GOLDEN_MODE::STATUS_PLANES:
+		checkmate.SetStatusPlanes(true);
+		break;
+	}
+	checkmate.SetLegacyTableFiles(true); // to compare with the checked in tables
+	checkmate.Initialize(pieces, false);
+}
+
+bool RunGoldenTables(bool update)
+{
+	vector<string> signatures = GoldenSignatures();
+	if (signatures.empty())
+	{
+		cout << "Error. The golden tables have 3 or 4 pieces. Build with NUM_PIECES = 3 or 4." << endl;
+		return false;
+	}
+	const int tableCount = (int)signatures.size();
+
+	vector<GOLDEN_HASHES> golden;
+	bool haveGolden = !update && ReadGoldenHashes(signatures, golden);
+	if (!update && !haveGolden)
+		cout << "There is no complete " << GoldenFilename() << ". Run -golden=update to make one." << endl;
+
+	// The checked in tables, before making new ones over them.
+	vector< vector< PIECE_TYPES> > tables(tableCount);
+	vector<string> filenames(tableCount);
+	vector< vector<char> > legacyTables(tableCount);
+	vector< vector<char> > legacyStatuses(tableCount);
+	vector<bool> haveLegacy(tableCount, false);
+	for (int t = 0; t < tableCount; t++)
+	{
+		BuildScheduler::PiecesFromSignature(signatures[t], tables[t]);
+		filenames[t] = Checkmate().MakeFilenameFromPieces(tables[t]);
+		if (NUM_PIECES != 3)
+			continue; // only the 3 piece tables were checked in
+		haveLegacy[t] = ReadWholeFile(filenames[t] + ".table.bin", legacyTables[t]) &&
+			ReadWholeFile(filenames[t] + ".status.bin", legacyStatuses[t]);
+		if (!haveLegacy[t])
+			cout << "There is no checked in " << signatures[t] << " table. Only comparing hashes." << endl;
+	}
+
+	bool same = true;
+	vector<GOLDEN_HASHES> made(tableCount);
+	vector<string> results;
+	for (int m = 0; m < GOLDEN_MODE_COUNT; m++)
+	{
+		for (int t = 0; t < tableCount; t++)
+		{
+			string name = signatures[t] + " " + gGoldenModeNames[m];
+			cout << "\nGolden " << name << endl;
+			Checkmate checkmate;
+			MakeTable(checkmate, tables[t], (GOLDEN_MODE)m);
+
+			GOLDEN_HASHES hashes;
+			long long totalPositions = GetTotalPositions(tables[t]);
+			INDEX_LAYOUT layout = checkmate.mIndexLayout;
+			if (!HashTurnMajorFile(filenames[t] + ".table.bin", totalPositions, layout, hashes.table) ||
+				!HashTurnMajorFile(filenames[t] + ".status.bin", totalPositions, layout, hashes.status) ||
+				!HashTurnMajorFile(filenames[t] + ".combined.bin", totalPositions, layout, hashes.combined) ||
+				!HashTurnMajorFile(filenames[t] + ".dtz.bin", totalPositions, layout, hashes.dtz) ||
+				!HashTurnMajorOverflows(filenames[t], layout, hashes.overflows))
+			{
+				cout << "  Error. The " << name << " build wrote no table." << endl;
+				results.push_back(name + ": MISSING");
+				same = false;
+				continue;
+			}
+
+			bool tableSame = true;
+			string differs;
+			if (m == (int)GOLDEN_MODE::SERIAL)
+			{
+				made[t] = hashes;
+				if (!checkmate.VerifyTable(1))
+				{
+					tableSame = false;
+					differs += " verifier";
+				}
+				if (haveLegacy[t])
+				{
+					vector<char> table, status;
+					ReadWholeFile(filenames[t] + ".table.bin", table);
+					ReadWholeFile(filenames[t] + ".status.bin", status);
+					vector<char> legacyTable = legacyTables[t];
+					vector<char> legacyStatus = legacyStatuses[t];
+					if (!ConvertLegacyTable(legacyTable, legacyStatus, status))
+					{
+						CompareBytes(checkmate, "checked in status", status, legacyStatus);
+						tableSame = false;
+					}
+					else if (!CompareBytes(checkmate, "checked in table", table, legacyTable))
+						tableSame = false;
+					if (!tableSame)
+						differs += " checked in";
+				}
+			}
+			else if (!SameHashes(hashes, made[t]))
+			{
+				tableSame = false;
+				differs += " serial";
+			}
+			if (haveGolden && !SameHashes(hashes, golden[t]))
+			{
+				tableSame = false;
+				differs += " golden.txt";
+			}
+			results.push_back(name + (tableSame ? ": same" : ": DIFFERENT from" + differs) +
+				" (" + checkmate.mReport.mStrategy + ")");
+			same = same && tableSame;
+		}
+	}
+
+	// Put the checked in tables back, and delete everything else the builds made.
+	for (int t = 0; t < tableCount; t++)
+	{
+		if (haveLegacy[t])
+		{
+			WriteWholeFile(filenames[t] + ".table.bin", legacyTables[t]);
+			WriteWholeFile(filenames[t] + ".status.bin", legacyStatuses[t]);
+		}
+		else
+		{
+			remove((filenames[t] + ".table.bin").c_str());
+			remove((filenames[t] + ".status.bin").c_str());
+		}
+		for (int f = 0; f < GOLDEN_MADE_FILE_COUNT; f++)
+			remove((filenames[t] + gGoldenMadeFiles[f]).c_str());
+	}
+
+	cout << "\nGolden tables:" << endl;
+	for (unsigned int r = 0; r < results.size(); r++)
+		cout << "  " << results[r] << endl;
+	if (update)
+	{
+		if (!same)
+		{
+			cout << "Not updating " << GoldenFilename() << ", because the builds don't agree." << endl;
+			return false;
+		}
+		if (!WriteGoldenHashes(signatures, made))
+		{
+			cout << "Error. Could not write " << GoldenFilename() << endl;
+			return false;
+		}
+		cout << "Wrote " << GoldenFilename() << endl;
+	}
+	return same;
+}
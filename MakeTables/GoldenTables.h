@@ -0,0 +1,53 @@
+#pragma once
+// Golden table regression, to run before and after changing the solver or the index:
+//		MakeTables -golden
+//		MakeTables -golden=update
+//
+// Makes the small tables KQK, KRK, KBK, KNK, KkQ and KkP again in every way this program can make
+// a table (GOLDEN_MODE), and checks that every way gives exactly the same files, and the same
+// as the references:
+//	golden.txt, the hashes of each table's .table.bin, .status.bin, .combined.bin and .dtz.bin
+//		files, and of its two .overflow.bin files together, from the last -golden=update.
+//		-golden=update writes it from the serial build, after checking everything else.
+//	The WQ, WR, WB, WN, BQ and BP .table.bin and .status.bin files that were checked in with the
+//		project. They were made by an older generator, so they are converted before comparing
+//		(see ConvertLegacyTable in GoldenTables.cpp), and the checked in files are put back after.
+//		Everything else the builds made is deleted.
+// Each difference is printed with the first position that differs, decoded.
+// The serial build is also checked against itself, B and Z, position by position (VerifyTable),
+// so a wrong count that every way agrees on still fails. KPkp has wins whose only capture or pawn
+// move is a promotion to a draw, so with NUM_PIECES = 4 its DTZ is checked over those lines too.
+// The tables need NUM_PIECES = 3. With NUM_PIECES = 4, the two pawn table KPkp is checked the same
+// way instead, with the tables it needs, against golden4.txt. Nothing of those was checked in.
+// A new way of making tables, or an option that changes how the solver goes, gets a GOLDEN_MODE
+// here too, so it is checked against all the others.
+
+#include <string>
+
+//	HUGE_PAGES_NUMA: transparent huge pages, and the big arrays interleaved over the NUMA nodes.
+//	TURN_INTERLEAVED: INDEX_LAYOUT::TURN_INTERLEAVED. Its files are put back in turn major order,
+//		without the index footer, before they are hashed or compared.
+//	KING_TILED: SOLVER_ORDER::KING_TILED solver passes.
+//	PREFETCH: solver passes that prefetch successors (Checkmate::SetSolverPrefetch).
+//	STATUS_PLANES: IsLegalPosition reading the illegal bit plane (Checkmate::SetStatusPlanes).
+enum class GOLDEN_MODE { SERIAL, PARTITIONED, NO_MOVE_CACHE, OUT_OF_CORE, HUGE_PAGES_NUMA, TURN_INTERLEAVED,
+		KING_TILED, PREFETCH, STATUS_PLANES };
+const int GOLDEN_MODE_COUNT = 9;
+const char gGoldenModeNames[GOLDEN_MODE_COUNT][20] = {
+		"serial", "partitioned", "no move cache", "out of core", "huge pages, numa", "turn interleaved",
+		"king tiled", "prefetch", "status planes"};
+const int GOLDEN_PARTITION_WORKERS = 2;
+const long long GOLDEN_RESIDENT_BYTES = 256 * 1024; // small, so out of core uses many blocks
+const long long GOLDEN_TWO_PAWN_RESIDENT_BYTES = 64 * 1024 * 1024; // about 64 blocks of the 4 piece tables
+
+// In the order they are made, so BQ is made before BP loads it for its promotions.
+const int GOLDEN_TABLE_COUNT = 6;
+const char gGoldenTables[GOLDEN_TABLE_COUNT][3] = {
+		"WQ", "WR", "WB", "WN", "BQ", "BP"};
+// The same for NUM_PIECES = 4. WPBP's promotions load WQBP and WPBQ, whose promotions load WQBQ.
+const int GOLDEN_TWO_PAWN_TABLE_COUNT = 4;
+const char gGoldenTwoPawnTables[GOLDEN_TWO_PAWN_TABLE_COUNT][5] = {
+		"WQBQ", "WQBP", "WPBQ", "WPBP"};
+
+// Returns false if any table differs. With update, writes golden.txt instead of reading it.
+bool RunGoldenTables(bool update);
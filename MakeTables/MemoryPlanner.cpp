@@ -0,0 +1,224 @@
+/*
+Chooses a way to make a table that fits in memory.
+*/
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+#include "MemoryPlanner.h"
+
+// Measured successors per position are 31% to 74% of the empty board estimate for the 3 and 4
+// piece tables. Pieces get in each other's way, and illegal positions have no successors.
+// Queens put the other king in check so often that the average never got past 9.7 (KQKR).
+const double MOVE_CACHE_FRACTION = 0.8;
+const double MAX_SUCCESSORS_PER_POSITION = 12;
+
+// About how much slower each strategy is than FULL_MOVE_CACHE. NO_MOVE_CACHE measured 3.5 to 5
+// times slower with -benchmark=successors, since it makes every successor again with the slow
+// GatherLegalMovesForPiece path, so it is planned at the slow end.
+const double gStrategyRelativeTimes[5] = {
+		0.5, 1.0, 1.3, 1.5, 5.0};
+
+long long GetTotalPositions(const std::vector< PIECE_TYPES>& pieces)
+{
+	long long totalPositions = 2 * KING_SQUARES * KING_SQUARES;
+	for (unsigned int i = 2; i < pieces.size(); i++)
+		totalPositions *= OTHER_SQUARES;
+	return totalPositions;
+}
+
+// How many squares a piece on square can move to, if nothing else is on the board.
+static int EmptyBoardMoves(PIECE_TYPES piece, int square)
+{
+	int row = square / 8;
+	int column = square % 8;
+	int moves = 0;
+	switch (piece)
+	{
+	case PIECE_TYPES::WHITE_PAWN:
+		if (row == 0 || row == 7)
+			return 0;
+		return (row == 1) ? 2 : 1;
+	case PIECE_TYPES::BLACK_PAWN:
+		if (row == 0 || row == 7)
+			return 0;
+		return (row == 6) ? 2 : 1;
+	case PIECE_TYPES::WHITE_KNIGHT:
+	case PIECE_TYPES::BLACK_KNIGHT:
+	{
+		const int dr[8] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+		const int dc[8] = { 2, 1, -1, -2, -2, -1, 1, 2 };
+		for (int d = 0; d < 8; d++)
+			if (row + dr[d] >= 0 && row + dr[d] <= 7 && column + dc[d] >= 0 && column + dc[d] <= 7)
+				moves++;
+		return moves;
+	}
+	default:
+		break;
+	}
+
+	bool king = (piece == PIECE_TYPES::WHITE_KING || piece == PIECE_TYPES::BLACK_KING);
+	bool straight = king || piece == PIECE_TYPES::WHITE_ROOK || piece == PIECE_TYPES::BLACK_ROOK ||
+		piece == PIECE_TYPES::WHITE_QUEEN || piece == PIECE_TYPES::BLACK_QUEEN;
+	bool diagonal = king || piece == PIECE_TYPES::WHITE_BISHOP || piece == PIECE_TYPES::BLACK_BISHOP ||
+		piece == PIECE_TYPES::WHITE_QUEEN || piece == PIECE_TYPES::BLACK_QUEEN;
+	for (int dr = -1; dr <= 1; dr++)
+		for (int dc = -1; dc <= 1; dc++)
+		{
+			if ((dr == 0 && dc == 0) || (dr != 0 && dc != 0 && !diagonal) || ((dr == 0 || dc == 0) && !straight))
+				continue;
+			for (int r = row + dr, c = column + dc; r >= 0 && r <= 7 && c >= 0 && c <= 7; r += dr, c += dc)
+			{
+				moves++;
+				if (king)
+					break;
+			}
+		}
+	return moves;
+}
+
+long long EstimateMoveCacheEntries(const std::vector< PIECE_TYPES>& pieces)
+{
+	// Average moves for each side, over every square. Pieces other than the kings are dead
+	// (no moves) on one of their OTHER_SQUARES.
+	double sideMoves[2] = { 0, 0 };
+	for (unsigned int i = 0; i < pieces.size(); i++)
+	{
+		double average = 0;
+		for (int square = 0; square < KING_SQUARES; square++)
+			average += EmptyBoardMoves(pieces[i], square);
+		average /= (i < 2) ? KING_SQUARES : OTHER_SQUARES;
+		sideMoves[pieces[i] < PIECE_TYPES::BLACK_KING ? 0 : 1] += average;
+	}
+	// Half the positions are each side's turn.
+	double perPosition = min((sideMoves[0] + sideMoves[1]) / 2 * MOVE_CACHE_FRACTION, MAX_SUCCESSORS_PER_POSITION);
+	return (long long)(GetTotalPositions(pieces) * perPosition) + 1;
+}
+
+MEMORY_PLAN PlanTableMemory(const std::vector< PIECE_TYPES>& pieces, const MEMORY_PLAN_OPTIONS& options)
+{
+	long long budget = options.budgetBytes ? options.budgetBytes : GetAvailableMemory();
+	long long totalPositions = GetTotalPositions(pieces);
+
+	MEMORY_PLAN plan;
+	plan.moveCacheEntries = EstimateMoveCacheEntries(pieces);
+
+	// B, S and Z, and the promoted table loaded for pawns (AssignPawnPromotions).
+	long long tableBytes = totalPositions * 3;
+	bool pawns = false;
+	for (unsigned int i = 2; i < pieces.size(); i++)
+		if (pieces[i] == PIECE_TYPES::WHITE_PAWN || pieces[i] == PIECE_TYPES::BLACK_PAWN)
+		{
+			tableBytes += totalPositions * 3;
+			pawns = true;
+			break;
+		}
+	tableBytes += totalPositions * STATUS_PLANE_COUNT / 8; // Checkmate::mStatusPlanes, if it is used
+	long long offsetBytes = (totalPositions + 1) * sizeof(long long); // mLegalMoves2
+	long long cacheBytes = plan.moveCacheEntries * sizeof(unsigned int) + offsetBytes;
+
+	for (int s = 0; s < 5; s++)
+	{
+		STRATEGY_ESTIMATE estimate;
+		estimate.strategy = (GENERATION_STRATEGY)s;
+		estimate.relativeTime = gStrategyRelativeTimes[s];
+		estimate.available = false;
+		switch (estimate.strategy)
+		{
+		case GENERATION_STRATEGY::SYMMETRY_REDUCED_INDEX:
+			// An eighth of the positions without pawns, half with.
+			estimate.peakBytes = (tableBytes + cacheBytes) / (pawns ? 2 : 8);
+			break;
+		case GENERATION_STRATEGY::FULL_MOVE_CACHE:
+			estimate.peakBytes = tableBytes + cacheBytes;
+			estimate.available = options.allowMoveCache;
+			break;
+		case GENERATION_STRATEGY::COMPRESSED_MOVE_CACHE:
+			// Two byte successors, relative to the position, and one offset per 64 positions.
+			estimate.peakBytes = tableBytes + plan.moveCacheEntries * 2 + offsetBytes / 64;
+			break;
+		case GENERATION_STRATEGY::OUT_OF_CORE:
+			// Only the legal moves cache stays within the resident size. B, S and Z are read
+			// everywhere, and written back only when the operating system chooses, so all of them count.
+			estimate.peakBytes = tableBytes + min(options.allowMoveCache ? cacheBytes : 0,
+				options.outOfCoreResidentBytes ? options.outOfCoreResidentBytes : budget);
+			estimate.available = options.allowOutOfCore;
+			break;
+		case GENERATION_STRATEGY::NO_MOVE_CACHE:
+			estimate.peakBytes = tableBytes;
+			estimate.available = true;
+			break;
+		}
+		estimate.fits = estimate.peakBytes <= budget;
+		plan.estimates.push_back(estimate);
+	}
+
+	// The estimates are in order of speed.
+	plan.fits = false;
+	for (unsigned int e = 0; e < plan.estimates.size() && !plan.fits; e++)
+	{
+		if (plan.estimates[e].available && plan.estimates[e].fits)
+		{
+			plan.strategy = plan.estimates[e].strategy;
+			plan.peakBytes = plan.estimates[e].peakBytes;
+			plan.fits = true;
+		}
+	}
+	if (!plan.fits)
+	{
+		// Nothing fits. Out-of-core will still finish, just very slowly, so use it if we can.
+		plan.strategy = options.allowOutOfCore ? GENERATION_STRATEGY::OUT_OF_CORE : GENERATION_STRATEGY::NO_MOVE_CACHE;
+		plan.peakBytes = plan.estimates[(int)plan.strategy].peakBytes;
+	}
+	return plan;
+}
+
+void PrintMemoryPlan(const std::string& signature, const MEMORY_PLAN& plan, long long budgetBytes)
+{
+	long long megabyte = 1024 * 1024;
+	cout << "\nMemory plan for " << signature << ", budget " << budgetBytes / megabyte << " MB:" << endl;
+	for (unsigned int e = 0; e < plan.estimates.size(); e++)
+	{
+		const STRATEGY_ESTIMATE& estimate = plan.estimates[e];
+		cout << "\t" << gGenerationStrategyNames[(int)estimate.strategy] << ": "
+			<< estimate.peakBytes / megabyte << " MB, about " << estimate.relativeTime << "x the time, ";
+		if (!estimate.available)
+			cout << "not available";
+		else
+			cout << (estimate.fits ? "fits" : "does not fit");
+		cout << endl;
+	}
+	cout << "Using " << gGenerationStrategyNames[(int)plan.strategy] << ", peak " << plan.peakBytes / megabyte << " MB";
+	if (!plan.fits)
+		cout << ". Nothing fits in " << budgetBytes / megabyte << " MB!";
+	cout << endl;
+}
+
+long long GetAvailableMemory()
+{
+#ifdef _WIN32
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	GlobalMemoryStatusEx(&status);
+	return (long long)status.ullTotalPhys;
+#else
+	long long bytes = (long long)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+
+	// cgroup v2, then v1. v2 says "max" when there is no limit, which doesn't read as a number.
+	const char* limitFiles[2] = { "/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes" };
+	for (int f = 0; f < 2; f++)
+	{
+		ifstream limitFile(limitFiles[f]);
+		long long limit = 0;
+		if (limitFile >> limit && limit > 0 && limit < bytes)
+			bytes = limit;
+	}
+	return bytes;
+#endif
+}
@@ -0,0 +1,62 @@
+#pragma once
+// Chooses how to make a table before any of its memory is allocated, so a table that can't fit
+// stops with a message instead of being killed for running out of memory.
+//
+// The strategies, fastest first:
+//		SYMMETRY_REDUCED_INDEX: only one position of each set of mirror images. Not in this build yet.
+//		FULL_MOVE_CACHE: B, S, Z and every position's successors in memory. The normal way.
+//		COMPRESSED_MOVE_CACHE: the successors stored smaller. Not in this build yet.
+//		OUT_OF_CORE: everything in scratch files (Checkmate::SetOutOfCore). Needs a scratch directory.
+//			Only the legal moves cache is kept within the resident size, so B, S and Z still have to fit.
+//		NO_MOVE_CACHE: successors made as they are needed (Checkmate::SetOnTheFlySuccessors), with
+//			the same slow move generator that fills the cache, so 3.5 to 5 times slower.
+// The planner estimates the peak memory of each one, and picks the fastest one that is in this
+// build, is allowed, and fits in the budget. Every estimate and the choice are printed.
+//
+// The budget defaults to GetAvailableMemory, which knows about cgroup memory limits.
+
+#include <string>
+#include <vector>
+#include "CheckmateGeneral.h"
+
+enum class GENERATION_STRATEGY {
+		SYMMETRY_REDUCED_INDEX, FULL_MOVE_CACHE, COMPRESSED_MOVE_CACHE, OUT_OF_CORE, NO_MOVE_CACHE};
+const char gGenerationStrategyNames[5][24] = {
+		"symmetry-reduced index", "full move cache", "compressed move cache", "out-of-core", "no move cache"};
+
+struct STRATEGY_ESTIMATE
+{
+	GENERATION_STRATEGY strategy;
+	long long peakBytes;
+	double relativeTime; // compared to FULL_MOVE_CACHE
+	bool available; // in this build, and allowed
+	bool fits;
+};
+
+struct MEMORY_PLAN
+{
+	GENERATION_STRATEGY strategy;
+	long long peakBytes;
+	long long moveCacheEntries; // how many successors to make room for, if there is a cache
+	bool fits; // false if no strategy fits in the budget
+	std::vector<STRATEGY_ESTIMATE> estimates; // every strategy, in the order above
+};
+
+struct MEMORY_PLAN_OPTIONS
+{
+	long long budgetBytes; // 0 means GetAvailableMemory()
+	bool allowMoveCache; // false to only consider strategies without a move cache
+	bool allowOutOfCore; // true if there is a scratch directory
+	long long outOfCoreResidentBytes; // what out-of-core is asked to stay within
+};
+
+MEMORY_PLAN PlanTableMemory(const std::vector< PIECE_TYPES>& pieces, const MEMORY_PLAN_OPTIONS& options);
+void PrintMemoryPlan(const std::string& signature, const MEMORY_PLAN& plan, long long budgetBytes);
+
+// How many successors all the positions of this piece set have, or a bit more.
+// Worked out from how many squares each piece can move to on an empty board.
+long long EstimateMoveCacheEntries(const std::vector< PIECE_TYPES>& pieces);
+long long GetTotalPositions(const std::vector< PIECE_TYPES>& pieces);
+
+// Physical memory, or the cgroup memory limit if that is smaller.
+long long GetAvailableMemory();
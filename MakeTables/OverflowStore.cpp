@@ -0,0 +1,180 @@
+/*
+Move counts too big for a char.
+*/
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "OverflowStore.h"
+
+// Returns what was in *slot. Only writes it if that was expected.
+static unsigned int CompareAndSwap(unsigned int* slot, unsigned int expected, unsigned int desired)
+{
+#ifdef _WIN32
+	return (unsigned int)InterlockedCompareExchange((volatile LONG*)slot, (LONG)desired, (LONG)expected);
+#else
+	return __sync_val_compare_and_swap(slot, expected, desired);
+#endif
+}
+
+OverflowStore::OverflowStore()
+{
+	mEntries = NULL;
+	mCapacity = 0;
+	mKind = TABLE_MEMORY::HEAP;
+	mHeapEntryCount = 0;
+}
+
+OverflowStore::~OverflowStore()
+{
+	Free();
+}
+
+void OverflowStore::Allocate(long long capacity, TABLE_MEMORY kind)
+{
+	Free();
+	mCapacity = MIN_OVERFLOW_CAPACITY;
+	while (mCapacity < capacity)
+		mCapacity *= 2;
+	mKind = kind;
+	mHeapEntryCount = 0;
+	mEntries = (OVERFLOW_ENTRY*)AllocateTableMemory(mCapacity * sizeof(OVERFLOW_ENTRY), kind);
+	Assert(mEntries != NULL, "Could not get the memory for the overflow store");
+	for (long long slot = 0; slot < mCapacity; slot++)
+	{
+		mEntries[slot].position = EMPTY_OVERFLOW_POSITION;
+		mEntries[slot].count = 0;
+	}
+}
+
+void OverflowStore::Free()
+{
+	if (mEntries)
+		FreeTableMemory(mEntries);
+	mEntries = NULL;
+	mCapacity = 0;
+	mHeapEntryCount = 0;
+}
+
+// Where the search for position starts.
+long long OverflowStore::FindSlot(unsigned int position)
+{
+	return (long long)(((position * 0x9E3779B97F4A7C15ULL) >> 32) & (mCapacity - 1));
+}
+
+void OverflowStore::Set(int position, int count)
+{
+	if (mEntries == NULL)
+		Allocate(MIN_OVERFLOW_CAPACITY, TABLE_MEMORY::HEAP);
+	if (mKind == TABLE_MEMORY::HEAP && (mHeapEntryCount + 1) * 2 > mCapacity)
+		Grow();
+
+	unsigned int key = (unsigned int)position;
+	long long slot = FindSlot(key);
+	for (long long probes = 0; probes < mCapacity; probes++)
+	{
+		unsigned int current = mEntries[slot].position;
+		if (current == EMPTY_OVERFLOW_POSITION)
+		{
+			current = CompareAndSwap(&mEntries[slot].position, EMPTY_OVERFLOW_POSITION, key);
+			if (current == EMPTY_OVERFLOW_POSITION)
+			{
+				mEntries[slot].count = count;
+				mHeapEntryCount++;
+				return;
+			}
+		}
+		if (current == key)
+		{
+			mEntries[slot].count = count;
+			return;
+		}
+		slot = (slot + 1) & (mCapacity - 1);
+	}
+	Assert(false, "The overflow store is full. Lower OVERFLOW_POSITIONS_PER_SLOT.");
+}
+
+int OverflowStore::Get(int position)
+{
+	if (mEntries == NULL)
+		return 0;
+	unsigned int key = (unsigned int)position;
+	long long slot = FindSlot(key);
+	for (long long probes = 0; probes < mCapacity; probes++)
+	{
+		if (mEntries[slot].position == key)
+			return mEntries[slot].count;
+		if (mEntries[slot].position == EMPTY_OVERFLOW_POSITION)
+			return 0;
+		slot = (slot + 1) & (mCapacity - 1);
+	}
+	return 0;
+}
+
+long long OverflowStore::GetEntryCount()
+{
+	long long count = 0;
+	for (long long slot = 0; slot < mCapacity; slot++)
+		if (mEntries[slot].position != EMPTY_OVERFLOW_POSITION)
+			count++;
+	return count;
+}
+
+// Only for HEAP stores, which no other process can be using.
+void OverflowStore::Grow()
+{
+	OVERFLOW_ENTRY* oldEntries = mEntries;
+	long long oldCapacity = mCapacity;
+	mEntries = NULL;
+	Allocate(oldCapacity * 2, TABLE_MEMORY::HEAP);
+	for (long long slot = 0; slot < oldCapacity; slot++)
+		if (oldEntries[slot].position != EMPTY_OVERFLOW_POSITION)
+			Set(oldEntries[slot].position, oldEntries[slot].count);
+	FreeTableMemory(oldEntries);
+}
+
+bool OverflowStore::Save(const std::string& filename)
+{
+	vector<OVERFLOW_ENTRY> entries;
+	for (long long slot = 0; slot < mCapacity; slot++)
+		if (mEntries[slot].position != EMPTY_OVERFLOW_POSITION)
+			entries.push_back(mEntries[slot]);
+	sort(entries.begin(), entries.end(),
+		[](const OVERFLOW_ENTRY& a, const OVERFLOW_ENTRY& b) { return a.position < b.position; });
+
+	ofstream fout(filename, ios::binary);
+	if (!fout)
+		return false;
+	long long count = (long long)entries.size();
+	fout.write((const char*)&count, sizeof(count));
+	if (count)
+		fout.write((const char*)&entries[0], count * sizeof(OVERFLOW_ENTRY));
+	return (bool)fout;
+}
+
+bool OverflowStore::Load(const std::string& filename)
+{
+	Free();
+	ifstream fin(filename, ios::binary);
+	if (!fin)
+		return true; // made before there were overflow files, so there were no overflows
+	long long count = 0;
+	fin.read((char*)&count, sizeof(count));
+	vector<OVERFLOW_ENTRY> entries((size_t)count);
+	if (count)
+		fin.read((char*)&entries[0], count * sizeof(OVERFLOW_ENTRY));
+	if (!fin)
+	{
+		cout << "The overflow data in " << filename << " is too short." << endl;
+		return false;
+	}
+	Allocate(count * 2, TABLE_MEMORY::HEAP);
+	for (long long e = 0; e < count; e++)
+		Set(entries[e].position, entries[e].count);
+	return true;
+}
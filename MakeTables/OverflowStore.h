@@ -0,0 +1,52 @@
+#pragma once
+// Move counts too big for a char (see POSITIVE_OVERFLOW in CheckmateGeneral.h).
+// B (or Z) holds POSITIVE_OVERFLOW or NEGATIVE_OVERFLOW for these positions, and the real count
+// is kept here, so only the few very long mates cost more than a byte.
+//
+// It is an open addressing hash table in table memory. Made SHARED, partition workers can all
+// add to it at once: a slot is taken with compare-and-swap, and the solver never reads a count
+// in the same pass it is added (see RunSolverPass).
+// It is saved as <name>.<table>.overflow.bin: the number of entries, then the entries in position
+// order, so the same table always makes the same file.
+
+#include <string>
+#include "TableMemory.h"
+
+// A table gets this many positions per overflow slot, or MIN_OVERFLOW_CAPACITY slots.
+const int OVERFLOW_POSITIONS_PER_SLOT = 1024;
+const long long MIN_OVERFLOW_CAPACITY = 4096;
+
+struct OVERFLOW_ENTRY
+{
+	unsigned int position; // EMPTY_OVERFLOW_POSITION if the slot is free
+	int count;
+};
+const unsigned int EMPTY_OVERFLOW_POSITION = 0xFFFFFFFF;
+
+class OverflowStore
+{
+public:
+	OverflowStore();
+	~OverflowStore();
+
+	// Room for at least capacity entries. HEAP stores grow as needed. Other kinds may be
+	// shared with other processes, so they can't move, and stop the program when full.
+	void Allocate(long long capacity, TABLE_MEMORY kind);
+	void Free();
+
+	void Set(int position, int count);
+	int Get(int position); // zero if position isn't here
+	long long GetEntryCount();
+
+	bool Save(const std::string& filename);
+	bool Load(const std::string& filename); // a missing file loads as empty
+
+private:
+	OVERFLOW_ENTRY* mEntries;
+	long long mCapacity; // a power of two
+	TABLE_MEMORY mKind;
+	long long mHeapEntryCount; // only kept for HEAP stores, to know when to grow
+
+	long long FindSlot(unsigned int position);
+	void Grow();
+};
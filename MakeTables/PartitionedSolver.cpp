@@ -0,0 +1,300 @@
+/*
+Multi-process solving.
+
+The coordinator (the process that called Initialize) forks mPartitionWorkers child processes
+after the legal moves cache is made. The children see the cache copy-on-write, and see B and S
+through SHARED (or out-of-core, FILE_BACKED) mappings, so every write a child makes is seen by all.
+
+Worker w owns black king squares [64*w/W, 64*(w+1)/W). With INDEX_LAYOUT::TURN_MAJOR, ToIndex puts
+the turn first and the black king second, so that is one contiguous range of indices for each turn.
+With TURN_INTERLEAVED the black king comes first, so it is one range with both turns in it, and
+each turn is every other index of it (see mSolverTurn). KING_TILED (SOLVER_ORDER), a worker goes
+through its black kings' king pairs in that order instead. The order is made before the worker is
+forked (mTiledKingPairs).
+
+Each solver pass is two steps. First every worker does its White's turn range, then every worker
+does its Black's turn range. The coordinator waits for all workers between steps, which is the
+barrier, and adds up the counts. This gives exactly the table a single process makes
+(see RunSolverPass).
+
+With NUMA_POLICY::PARTITIONED, each worker's ranges of B, S and the legal moves cache are moved to
+NUMA node (worker % nodes) before forking, and the worker only runs on that node's processors.
+
+Commands and results go over pipes. If a worker dies, its result pipe closes, and the coordinator
+reports which partition was lost instead of waiting forever.
+Workers never print or allocate, since another thread may have held those locks when we forked.
+*/
+#include <iostream>
+#include <algorithm>
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+using namespace std;
+#include "CheckmateGeneral.h"
+
+struct PARTITION_COMMAND
+{
+	int pass; // a SOLVER_PASS, or -1 to quit
+	int x;
+	int turn;
+};
+
+struct PARTITION_RESULT
+{
+	int whiteCount;
+	int blackCount;
+	long long successors; // read during the pass, for the BuildReport
+	double cpuSeconds;
+	long long counters[PERF_COUNTER_COUNT]; // -1 if not counted
+	double startWall; // GetWallSeconds() when the worker started and finished, for the trace
+	double endWall;
+};
+
+#ifndef _WIN32
+
+// Keeps reading or writing until all the bytes are done. Returns false on end of file or error.
+static bool ReadAll(int fd, void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		ssize_t got = read(fd, bytes, size);
+		if (got <= 0)
+			return false;
+		bytes += got;
+		size -= got;
+	}
+	return true;
+}
+
+static bool WriteAll(int fd, const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		ssize_t put = write(fd, bytes, size);
+		if (put <= 0)
+			return false;
+		bytes += put;
+		size -= put;
+	}
+	return true;
+}
+
+void Checkmate::StartPartitionWorkers()
+{
+	Assert(mTableMemory == TABLE_MEMORY::SHARED || mTableMemory == TABLE_MEMORY::FILE_BACKED,
+		"B and S must be SHARED or FILE_BACKED for partition workers");
+	int workers = min(mPartitionWorkers, KING_SQUARES);
+	cout << "\nStarting " << workers << " partition worker processes..." << endl;
+	cout.flush();
+	signal(SIGPIPE, SIG_IGN); // a dead worker shows up as a failed read, not a dead coordinator.
+
+	int nodes = (mNumaPolicy == NUMA_POLICY::PARTITIONED) ? GetNumaNodeCount() : 1;
+	if (nodes > 1)
+	{
+		cout << "Moving each partition to its NUMA node (" << nodes << " nodes)..." << endl;
+		for (int w = 0; w < workers; w++)
+			BindPartitionToNumaNode(w, workers, w % nodes);
+	}
+	else if (mNumaPolicy == NUMA_POLICY::PARTITIONED)
+		cout << "Only one NUMA node, so partitions stay where they are." << endl;
+
+	for (int w = 0; w < workers; w++)
+	{
+		if (mSolverOrder == SOLVER_ORDER::KING_TILED)
+			for (int turn = 0; turn < 2; turn++)
+				GetTiledKingPairs(turn, KING_SQUARES * w / workers, KING_SQUARES * (w + 1) / workers, mTiledKingPairs[turn]);
+
+		int commandPipe[2];
+		int resultPipe[2];
+		Assert(pipe(commandPipe) == 0 && pipe(resultPipe) == 0, "pipe() for partition worker");
+
+		pid_t pid = fork();
+		Assert(pid >= 0, "fork() for partition worker");
+		if (pid == 0)
+		{
+			close(commandPipe[1]);
+			close(resultPipe[0]);
+			for (unsigned int other = 0; other < mPartitionCommandFds.size(); other++)
+			{
+				close(mPartitionCommandFds[other]); // so earlier workers see end of file if the coordinator dies
+				close(mPartitionResultFds[other]);
+			}
+			PartitionWorkerLoop(w, commandPipe[0], resultPipe[1]);
+			_exit(0); // don't run destructors. B and S belong to the coordinator.
+		}
+
+		close(commandPipe[0]);
+		close(resultPipe[1]);
+		if (nodes > 1 && !RunProcessOnNumaNode((int)pid, w % nodes))
+			cout << "Could not run partition worker " << w << " on NUMA node " << w % nodes << endl;
+		mPartitionWorkerIds.push_back((int)pid);
+		mPartitionCommandFds.push_back(commandPipe[1]);
+		mPartitionResultFds.push_back(resultPipe[0]);
+	}
+}
+
+void Checkmate::StopPartitionWorkers()
+{
+	for (unsigned int w = 0; w < mPartitionWorkerIds.size(); w++)
+	{
+		PARTITION_COMMAND quit = { -1, 0, 0 };
+		WriteAll(mPartitionCommandFds[w], &quit, sizeof(quit));
+		close(mPartitionCommandFds[w]);
+		close(mPartitionResultFds[w]);
+		waitpid((pid_t)mPartitionWorkerIds[w], NULL, 0);
+	}
+	mPartitionWorkerIds.clear();
+	mPartitionCommandFds.clear();
+	mPartitionResultFds.clear();
+}
+
+// The positions worker goes through for turn. See above.
+void Checkmate::GetPartitionRange(int worker, int workers, int turn, long long& begin, long long& end)
+{
+	int firstKing = KING_SQUARES * worker / workers;
+	int lastKing = KING_SQUARES * (worker + 1) / workers;
+	if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+	{
+		begin = firstKing * (mTotalPositions / KING_SQUARES);
+		end = lastKing * (mTotalPositions / KING_SQUARES);
+		return;
+	}
+	long long positionsPerTurn = mTotalPositions / 2;
+	long long positionsPerKing = positionsPerTurn / KING_SQUARES;
+	begin = turn * positionsPerTurn + firstKing * positionsPerKing;
+	end = turn * positionsPerTurn + lastKing * positionsPerKing;
+}
+
+// Moves the parts of B, S and the legal moves cache that worker reads in index order to node.
+void Checkmate::BindPartitionToNumaNode(int worker, int workers, int node)
+{
+	// TURN_INTERLEAVED, both turns have the same range.
+	int turns = (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED) ? 1 : 2;
+	for (int turn = 0; turn < turns; turn++)
+	{
+		long long begin = 0;
+		long long end = 0;
+		GetPartitionRange(worker, workers, turn, begin, end);
+		BindTableMemoryRange(B, begin, end - begin, node);
+		BindTableMemoryRange(S, begin, end - begin, node);
+		if (mLegalMoves2)
+		{
+			BindTableMemoryRange(mLegalMoves2, begin * sizeof(long long), (end - begin) * sizeof(long long), node);
+			BindTableMemoryRange(mLegalMovesRawMemory, mLegalMoves2[begin] * sizeof(unsigned int),
+				(mLegalMoves2[end] - mLegalMoves2[begin]) * sizeof(unsigned int), node);
+		}
+	}
+}
+
+void Checkmate::PartitionWorkerLoop(int worker, int commandFd, int resultFd)
+{
+	int workers = min(mPartitionWorkers, KING_SQUARES);
+
+	// The coordinator's counters only count the coordinator, so each worker counts itself.
+	PerfCounters counters;
+	if (mReport.UsesPerfCounters())
+		counters.Open();
+
+	PARTITION_COMMAND command;
+	while (ReadAll(commandFd, &command, sizeof(command)) && command.pass >= 0)
+	{
+		long long begin = 0;
+		long long end = 0;
+		GetPartitionRange(worker, workers, command.turn, begin, end);
+		mSolverTurn = command.turn;
+		PARTITION_RESULT result = { 0, 0, 0, 0, {}, 0, 0 };
+		long long successorsBefore = mSuccessorsVisited;
+		result.startWall = GetWallSeconds();
+		double cpuBefore = GetCpuSeconds();
+		long long countersBefore[PERF_COUNTER_COUNT];
+		counters.Read(countersBefore);
+		if (mSolverOrder == SOLVER_ORDER::KING_TILED && mOutOfCoreBlockPositions == 0)
+			RunSolverPassTiled((SOLVER_PASS)command.pass, command.x, command.turn, mTiledKingPairs[command.turn],
+				result.whiteCount, result.blackCount, false);
+		else
+			RunSolverPassBlocks((SOLVER_PASS)command.pass, command.x, (int)begin, (int)end, result.whiteCount, result.blackCount);
+		result.successors = mSuccessorsVisited - successorsBefore;
+		result.cpuSeconds = GetCpuSeconds() - cpuBefore;
+		result.endWall = GetWallSeconds();
+		counters.Read(result.counters);
+		for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+			if (result.counters[c] >= 0)
+				result.counters[c] -= countersBefore[c];
+		if (!WriteAll(resultFd, &result, sizeof(result)))
+			break;
+	}
+}
+
+void Checkmate::RunPartitionedSolverPass(SOLVER_PASS pass, int x, int& whiteCount, int& blackCount)
+{
+	for (int turn = 0; turn < 2; turn++)
+	{
+		PARTITION_COMMAND command = { (int)pass, x, turn };
+		for (unsigned int w = 0; w < mPartitionWorkerIds.size(); w++)
+			WriteAll(mPartitionCommandFds[w], &command, sizeof(command));
+
+		// The barrier: every partition of this turn must be done before the other turn starts.
+		for (unsigned int w = 0; w < mPartitionWorkerIds.size(); w++)
+		{
+			PARTITION_RESULT result;
+			if (!ReadAll(mPartitionResultFds[w], &result, sizeof(result)))
+			{
+				int status = 0;
+				waitpid((pid_t)mPartitionWorkerIds[w], &status, 0);
+				cout << "Error. Partition worker " << w << " (process " << mPartitionWorkerIds[w] << ") died";
+				if (WIFSIGNALED(status))
+					cout << " from signal " << WTERMSIG(status);
+				cout << " during pass " << (int)pass << ", x = " << x << ", turn " << turn << endl;
+				mPartitionWorkerIds.erase(mPartitionWorkerIds.begin() + w);
+				mPartitionCommandFds.erase(mPartitionCommandFds.begin() + w);
+				mPartitionResultFds.erase(mPartitionResultFds.begin() + w);
+				StopPartitionWorkers();
+				Assert(false, "Partition worker died");
+			}
+			whiteCount += result.whiteCount;
+			blackCount += result.blackCount;
+			mSuccessorsVisited += result.successors;
+			mReport.AddCpuSeconds(result.cpuSeconds);
+			mReport.AddCounters(result.counters);
+			mReport.AddWorkerSpan(w, result.startWall, result.endWall);
+		}
+	}
+}
+
+#else
+
+// No fork on Windows. Solve in this process instead.
+void Checkmate::StartPartitionWorkers()
+{
+	cout << "\nPartition worker processes are not supported on Windows. Solving in one process." << endl;
+}
+
+void Checkmate::StopPartitionWorkers()
+{
+}
+
+void Checkmate::BindPartitionToNumaNode(int worker, int workers, int node)
+{
+}
+
+void Checkmate::PartitionWorkerLoop(int worker, int commandFd, int resultFd)
+{
+}
+
+void Checkmate::RunPartitionedSolverPass(SOLVER_PASS pass, int x, int& whiteCount, int& blackCount)
+{
+	for (int turn = 0; turn < 2; turn++)
+	{
+		mSolverTurn = turn;
+		if (mIndexLayout == INDEX_LAYOUT::TURN_INTERLEAVED)
+			RunSolverPassRange(pass, x, 0, (int)mTotalPositions, whiteCount, blackCount);
+		else
+			RunSolverPassRange(pass, x, (int)(turn * mTotalPositions / 2), (int)((turn + 1) * mTotalPositions / 2), whiteCount, blackCount);
+	}
+}
+
+#endif
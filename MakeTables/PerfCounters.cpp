@@ -0,0 +1,174 @@
+/*
+Hardware performance counters.
+*/
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+using namespace std;
+#include "PerfCounters.h"
+
+PerfCounters::PerfCounters()
+{
+	mOpenError = 0;
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		mFds[c] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+	Close();
+}
+
+PerfCounters::PerfCounters(const PerfCounters& other)
+{
+	mOpenError = other.mOpenError;
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		mFds[c] = -1;
+}
+
+PerfCounters& PerfCounters::operator=(const PerfCounters& other)
+{
+	if (this != &other)
+	{
+		Close();
+		mOpenError = other.mOpenError;
+	}
+	return *this;
+}
+
+#ifdef __linux__
+
+// The perf_event_attr type and config of each PERF_COUNTER.
+static void GetEventConfig(int counter, unsigned int& type, unsigned long long& config)
+{
+	const unsigned long long readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	switch ((PERF_COUNTER)counter)
+	{
+	case PERF_COUNTER::CYCLES:
+		type = PERF_TYPE_HARDWARE;
+		config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PERF_COUNTER::INSTRUCTIONS:
+		type = PERF_TYPE_HARDWARE;
+		config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PERF_COUNTER::LLC_MISSES:
+		type = PERF_TYPE_HW_CACHE;
+		config = PERF_COUNT_HW_CACHE_LL | readMiss;
+		break;
+	case PERF_COUNTER::DTLB_MISSES:
+		type = PERF_TYPE_HW_CACHE;
+		config = PERF_COUNT_HW_CACHE_DTLB | readMiss;
+		break;
+	case PERF_COUNTER::BRANCH_MISSES:
+		type = PERF_TYPE_HARDWARE;
+		config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	}
+}
+
+bool PerfCounters::Open()
+{
+	Close();
+	bool any = false;
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		GetEventConfig(c, attr.type, attr.config);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		mFds[c] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (mFds[c] < 0)
+		{
+			if (mOpenError == 0)
+				mOpenError = errno;
+			mFds[c] = -1;
+		}
+		else
+			any = true;
+	}
+	if (any)
+		mOpenError = 0;
+	return any;
+}
+
+void PerfCounters::Close()
+{
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		if (mFds[c] >= 0)
+			close(mFds[c]);
+		mFds[c] = -1;
+	}
+}
+
+void PerfCounters::Read(long long values[PERF_COUNTER_COUNT])
+{
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+	{
+		values[c] = -1;
+		unsigned long long data[3]; // value, time enabled, time running
+		if (mFds[c] < 0 || read(mFds[c], data, sizeof(data)) != sizeof(data))
+			continue;
+		if (data[2] == 0)
+			values[c] = 0; // never got to run
+		else if (data[2] < data[1])
+			values[c] = (long long)((double)data[0] * data[1] / data[2]);
+		else
+			values[c] = (long long)data[0];
+	}
+}
+
+#else
+
+// No perf_event_open.
+bool PerfCounters::Open()
+{
+	mOpenError = ENOSYS;
+	return false;
+}
+
+void PerfCounters::Close()
+{
+}
+
+void PerfCounters::Read(long long values[PERF_COUNTER_COUNT])
+{
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		values[c] = -1;
+}
+
+#endif
+
+bool PerfCounters::IsOpen()
+{
+	for (int c = 0; c < PERF_COUNTER_COUNT; c++)
+		if (mFds[c] >= 0)
+			return true;
+	return false;
+}
+
+const char* PerfCounters::DescribeError(int error)
+{
+	switch (error)
+	{
+	case EACCES:
+	case EPERM:
+		return "not allowed. Lower /proc/sys/kernel/perf_event_paranoid";
+	case ENOENT:
+	case EOPNOTSUPP:
+		return "this processor or virtual machine has none";
+	case ENOSYS:
+		return "this system can't read them";
+	default:
+		return strerror(error);
+	}
+}
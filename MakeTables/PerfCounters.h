@@ -0,0 +1,36 @@
+#pragma once
+// Hardware performance counters, to tell if a phase is waiting on memory or on the processor.
+// On Linux they are read with perf_event_open, counting only this process in user mode, so they
+// work with the default perf_event_paranoid of 2. Anywhere else, or when the kernel, a virtual
+// machine or the permissions don't allow them, Open fails and the build goes on without them.
+// A counter the processor doesn't have reads as -1, and the others still work.
+//
+// Also used inside partition workers, which measure their own part of each solver pass and send
+// it back with their results (see PartitionedSolver.cpp), so Open and Read don't allocate.
+
+enum class PERF_COUNTER { CYCLES, INSTRUCTIONS, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES };
+const int PERF_COUNTER_COUNT = 5;
+const char gPerfCounterNames[PERF_COUNTER_COUNT][20] = {
+		"cycles", "instructions", "llcMisses", "dtlbMisses", "branchMisses"};
+
+class PerfCounters
+{
+public:
+	PerfCounters();
+	~PerfCounters();
+	// Copies don't get the counters, so only the original closes them.
+	PerfCounters(const PerfCounters& other);
+	PerfCounters& operator=(const PerfCounters& other);
+
+	bool Open(); // false if no counter could be opened. mOpenError says why.
+	void Close();
+	bool IsOpen();
+	// Counts since Open, scaled up if the kernel had to share the counters between events.
+	void Read(long long values[PERF_COUNTER_COUNT]);
+
+	int mOpenError; // errno from the first counter, or 0
+	static const char* DescribeError(int error);
+
+private:
+	int mFds[PERF_COUNTER_COUNT]; // -1 for counters that aren't open
+};
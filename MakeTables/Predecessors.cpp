@@ -0,0 +1,347 @@
+/*
+Predecessors (unmoves).
+
+GeneratePredecessors goes backward from a position q to every position p with q in
+GenerateSuccessors(p), without going through the table. The side that just moved is the one not
+to move in q. Each of its pieces un-moves from every square it could have come from:
+	Kings and knights from the squares next to it or a knight's jump away, and bishops, rooks and
+		queens from along their lines, up to the first piece in the way. The square it came from
+		must be empty in q.
+	Pawns straight back one square, or two from their start row, over an empty square, and
+		diagonally back one square only as an un-capture.
+	An un-capture puts one of the other side's dead pieces back on the square the piece moved to.
+		Every piece but a pawn going straight can un-capture, and each dead piece is its own
+		predecessor, since pieces of the same kind still have their own place in the index.
+	An un-promotion is a pawn on its promotion row un-moving from the row before. Those positions
+		stand for the promoted queen's (AssignPawnPromotions copies them from that table by index),
+		so that is the move from this table into the promoted one.
+p must be legal, like every position GenerateSuccessors starts from, and so must q, like every
+position it moves to.
+
+CheckPredecessors counts how many times each position is a successor, going forward over the
+whole table, then checks that GeneratePredecessors finds that many for each, and that q is one of
+GenerateSuccessors(p) for each p it finds, once. Together, that means both generators make
+exactly the same moves.
+*/
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "Predecessors.h"
+#include "BuildScheduler.h"
+
+enum class PREDECESSOR_ERROR { WRONG_COUNT, NOT_A_PREDECESSOR, DUPLICATE };
+const int PREDECESSOR_ERROR_KINDS = 3;
+static const char gPredecessorErrorNames[PREDECESSOR_ERROR_KINDS][60] = {
+		"not as many predecessors as moves to it", "a predecessor that doesn't move to it",
+		"a predecessor found twice"};
+
+struct PREDECESSOR_RESULT
+{
+	long long counts[PREDECESSOR_ERROR_KINDS];
+	long long predecessors;
+	long long uncaptures;
+	long long unpromotions;
+	vector< pair<int, PREDECESSOR_ERROR> > kept; // the first PREDECESSOR_MAX_PRINTED
+};
+
+int Checkmate::UnmoveIndex(const int positions[], const LEGAL_MOVE& unmove)
+{
+	int before[POSITION_ARRAY_SIZE];
+	for (int i = 0; i < POSITION_ARRAY_SIZE; i++)
+		before[i] = positions[i];
+	before[0] = 1 - before[0]; // the turn of the side that moved
+	before[unmove.pieceIndex + 1] = unmove.oldPosition;
+	if (unmove.capture)
+		before[unmove.pieceIndex2 + 1] = unmove.newPosition;
+	return ToIndex(before);
+}
+
+// Adds the un-moves of pieceIndex from origin: without a capture if quiet, and with each
+// possible un-capture if capture. Only those from legal positions.
+void Checkmate::AddUnmoves(int pieceIndex, int origin, bool quiet, bool capture, const int positions[],
+	LEGAL_MOVE unmoves[MAX_PREDECESSORS], int& unmoveCount)
+{
+	LEGAL_MOVE unmove;
+	unmove.pieceIndex = pieceIndex;
+	unmove.oldPosition = origin;
+	unmove.newPosition = positions[pieceIndex + 1];
+	unmove.capture = false;
+	unmove.pieceIndex2 = 0;
+	unmove.oldPosition2 = unmove.newPosition;
+	unmove.newPosition2 = DEAD_POSITION;
+	if (quiet && IsLegalPosition(UnmoveIndex(positions, unmove)))
+		unmoves[unmoveCount++] = unmove;
+	if (!capture)
+		return;
+
+	PIECE_COLOR victim = OtherColor(GetColor(mPieces[pieceIndex]));
+	unmove.capture = true;
+	for (int pi = 2; pi < NUM_PIECES; pi++) // kings are never captured
+	{
+		if (GetColor(mPieces[pi]) != victim || positions[pi + 1] != DEAD_POSITION)
+			continue;
+		unmove.pieceIndex2 = pi;
+		if (IsLegalPosition(UnmoveIndex(positions, unmove)))
+			unmoves[unmoveCount++] = unmove;
+	}
+}
+
+// The moves that could have led to positions, as LEGAL_MOVEs from the position before.
+void Checkmate::GatherUnmoves(const int positions[], LEGAL_MOVE unmoves[MAX_PREDECESSORS], int& unmoveCount)
+{
+	unmoveCount = 0;
+	PIECE_COLOR moved = OtherColor((PIECE_COLOR)positions[0]);
+	const int kingSteps[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+	const int knightJumps[8][2] = { {1, -2}, {1, 2}, {-1, -2}, {-1, 2}, {2, -1}, {2, 1}, {-2, -1}, {-2, 1} };
+
+	for (int pieceIndex = 0; pieceIndex < NUM_PIECES; pieceIndex++)
+	{
+		PIECE_TYPES pieceType = mPieces[pieceIndex];
+		int position = positions[pieceIndex + 1];
+		if (GetColor(pieceType) != moved || position == DEAD_POSITION)
+			continue;
+		int row = position / 8;
+		int column = position % 8;
+
+		switch (pieceType)
+		{
+		case PIECE_TYPES::WHITE_KING:
+		case PIECE_TYPES::BLACK_KING:
+		case PIECE_TYPES::WHITE_KNIGHT:
+		case PIECE_TYPES::BLACK_KNIGHT:
+		{
+			bool king = (pieceType == PIECE_TYPES::WHITE_KING || pieceType == PIECE_TYPES::BLACK_KING);
+			for (int i = 0; i < 8; i++)
+			{
+				int r = row + (king ? kingSteps[i][0] : knightJumps[i][0]);
+				int c = column + (king ? kingSteps[i][1] : knightJumps[i][1]);
+				if (r >= 0 && r <= 7 && c >= 0 && c <= 7 && NoPieceHere(r, c, positions))
+					AddUnmoves(pieceIndex, r * 8 + c, true, true, positions, unmoves, unmoveCount);
+			}
+			break;
+		}
+		case PIECE_TYPES::WHITE_BISHOP:
+		case PIECE_TYPES::BLACK_BISHOP:
+		case PIECE_TYPES::WHITE_ROOK:
+		case PIECE_TYPES::BLACK_ROOK:
+		case PIECE_TYPES::WHITE_QUEEN:
+		case PIECE_TYPES::BLACK_QUEEN:
+		{
+			bool diagonals = (pieceType != PIECE_TYPES::WHITE_ROOK && pieceType != PIECE_TYPES::BLACK_ROOK);
+			bool lines = (pieceType != PIECE_TYPES::WHITE_BISHOP && pieceType != PIECE_TYPES::BLACK_BISHOP);
+			for (int i = 0; i < 8; i++)
+			{
+				bool diagonal = (kingSteps[i][0] != 0 && kingSteps[i][1] != 0);
+				if ((diagonal && !diagonals) || (!diagonal && !lines))
+					continue;
+				int r = row + kingSteps[i][0];
+				int c = column + kingSteps[i][1];
+				while (r >= 0 && r <= 7 && c >= 0 && c <= 7 && NoPieceHere(r, c, positions))
+				{
+					AddUnmoves(pieceIndex, r * 8 + c, true, true, positions, unmoves, unmoveCount);
+					r += kingSteps[i][0];
+					c += kingSteps[i][1];
+				}
+			}
+			break;
+		}
+		case PIECE_TYPES::WHITE_PAWN:
+		case PIECE_TYPES::BLACK_PAWN:
+		{
+			int direction = (moved == PIECE_COLOR::WHITE) ? +1 : -1;
+			int startRow = (moved == PIECE_COLOR::WHITE) ? 1 : 6;
+			int r = row - direction;
+			if (r < 0 || r > 7)
+				break;
+			if (NoPieceHere(r, column, positions))
+			{
+				AddUnmoves(pieceIndex, r * 8 + column, true, false, positions, unmoves, unmoveCount);
+				if (r - direction == startRow && NoPieceHere(r - direction, column, positions))
+					AddUnmoves(pieceIndex, (r - direction) * 8 + column, true, false, positions, unmoves, unmoveCount);
+			}
+			for (int c = column - 1; c <= column + 1; c += 2)
+				if (c >= 0 && c <= 7 && NoPieceHere(r, c, positions))
+					AddUnmoves(pieceIndex, r * 8 + c, false, true, positions, unmoves, unmoveCount);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+int Checkmate::GeneratePredecessors(int q, unsigned int predecessors[MAX_PREDECESSORS])
+{
+	if (!IsLegalPosition(q))
+		return 0; // no legal moves lead to an illegal position
+	int positions[POSITION_ARRAY_SIZE];
+	FromIndex(q, positions);
+	LEGAL_MOVE unmoves[MAX_PREDECESSORS];
+	int count = 0;
+	GatherUnmoves(positions, unmoves, count);
+	for (int i = 0; i < count; i++)
+		predecessors[i] = UnmoveIndex(positions, unmoves[i]);
+	return count;
+}
+
+bool Checkmate::CheckPredecessors(int threads)
+{
+	if (threads < 1)
+		threads = 1;
+	cout << "\nChecking the predecessors of " << GetSignature() << " on " << threads << " threads..." << endl;
+	time_t t1 = time(0);
+
+	// How many times each position is a successor. No position has more than MAX_PREDECESSORS.
+	unique_ptr< atomic<unsigned short>[] > moves(new atomic<unsigned short>[mTotalPositions]);
+	for (long long p = 0; p < mTotalPositions; p++)
+		moves[p] = 0;
+	vector<thread> workers;
+	vector<long long> successorCounts(threads, 0);
+	for (int t = 0; t < threads; t++)
+	{
+		int begin = (int)(mTotalPositions * t / threads);
+		int end = (int)(mTotalPositions * (t + 1) / threads);
+		workers.push_back(thread([this, begin, end, t, &moves, &successorCounts]()
+		{
+			unsigned int successors[MAX_SUCCESSORS];
+			for (int p = begin; p < end; p++)
+			{
+				int count = GenerateSuccessors(p, successors);
+				successorCounts[t] += count;
+				for (int m = 0; m < count; m++)
+					moves[successors[m]].fetch_add(1, memory_order_relaxed);
+			}
+		}));
+	}
+	for (int t = 0; t < threads; t++)
+		workers[t].join();
+	workers.clear();
+
+	vector<PREDECESSOR_RESULT> results(threads);
+	for (int t = 0; t < threads; t++)
+	{
+		int begin = (int)(mTotalPositions * t / threads);
+		int end = (int)(mTotalPositions * (t + 1) / threads);
+		workers.push_back(thread([this, begin, end, &moves, &results, t]()
+		{
+			PREDECESSOR_RESULT& result = results[t];
+			fill(result.counts, result.counts + PREDECESSOR_ERROR_KINDS, 0);
+			result.predecessors = 0;
+			result.uncaptures = 0;
+			result.unpromotions = 0;
+			for (int q = begin; q < end; q++)
+			{
+				int positions[POSITION_ARRAY_SIZE];
+				FromIndex(q, positions);
+				LEGAL_MOVE unmoves[MAX_PREDECESSORS];
+				int count = 0;
+				if (IsLegalPosition(q))
+					GatherUnmoves(positions, unmoves, count);
+				result.predecessors += count;
+
+				vector<PREDECESSOR_ERROR> errors;
+				if (count != moves[q])
+					errors.push_back(PREDECESSOR_ERROR::WRONG_COUNT);
+				unsigned int predecessors[MAX_PREDECESSORS];
+				for (int i = 0; i < count; i++)
+				{
+					predecessors[i] = UnmoveIndex(positions, unmoves[i]);
+					if (unmoves[i].capture)
+						result.uncaptures++;
+					PIECE_TYPES moved = mPieces[unmoves[i].pieceIndex];
+					if ((moved == PIECE_TYPES::WHITE_PAWN && unmoves[i].newPosition / 8 == 7) ||
+						(moved == PIECE_TYPES::BLACK_PAWN && unmoves[i].newPosition / 8 == 0))
+						result.unpromotions++;
+
+					unsigned int successors[MAX_SUCCESSORS];
+					int successorCount = GenerateSuccessors(predecessors[i], successors);
+					if (find(successors, successors + successorCount, (unsigned int)q) == successors + successorCount)
+						errors.push_back(PREDECESSOR_ERROR::NOT_A_PREDECESSOR);
+					if (find(predecessors, predecessors + i, predecessors[i]) != predecessors + i)
+						errors.push_back(PREDECESSOR_ERROR::DUPLICATE);
+				}
+				for (unsigned int e = 0; e < errors.size(); e++)
+				{
+					result.counts[(int)errors[e]]++;
+					if (result.kept.size() < PREDECESSOR_MAX_PRINTED)
+						result.kept.push_back(make_pair(q, errors[e]));
+				}
+			}
+		}));
+	}
+	for (int t = 0; t < threads; t++)
+		workers[t].join();
+
+	long long successors = 0;
+	long long predecessors = 0;
+	long long uncaptures = 0;
+	long long unpromotions = 0;
+	long long counts[PREDECESSOR_ERROR_KINDS] = { 0 };
+	vector< pair<int, PREDECESSOR_ERROR> > kept;
+	for (int t = 0; t < threads; t++)
+	{
+		successors += successorCounts[t];
+		predecessors += results[t].predecessors;
+		uncaptures += results[t].uncaptures;
+		unpromotions += results[t].unpromotions;
+		for (int e = 0; e < PREDECESSOR_ERROR_KINDS; e++)
+			counts[e] += results[t].counts[e];
+		kept.insert(kept.end(), results[t].kept.begin(), results[t].kept.end());
+	}
+	long long total = 0;
+	for (int e = 0; e < PREDECESSOR_ERROR_KINDS; e++)
+		total += counts[e];
+
+	cout << successors << " moves forward, " << predecessors << " back, of them " << uncaptures
+		<< " un-captures and " << unpromotions << " un-promotions, in " << (double)(time(0) - t1) << " seconds." << endl;
+	if (total == 0 && successors == predecessors)
+	{
+		cout << "The predecessors of " << GetSignature() << " agree with its successors." << endl;
+		return true;
+	}
+
+	cout << "Error. " << total << " predecessors don't agree with the successors:" << endl;
+	for (int e = 0; e < PREDECESSOR_ERROR_KINDS; e++)
+		if (counts[e])
+			cout << "  " << gPredecessorErrorNames[e] << ": " << counts[e] << endl;
+	for (unsigned int k = 0; k < kept.size() && k < PREDECESSOR_MAX_PRINTED; k++)
+	{
+		int positions[POSITION_ARRAY_SIZE];
+		FromIndex(kept[k].first, positions);
+		cout << "  position " << kept[k].first << " (" << (int)moves[kept[k].first] << " moves to it), "
+			<< gPredecessorErrorNames[(int)kept[k].second] << ": ";
+		PrintPosition(positions);
+	}
+	return false;
+}
+
+bool CheckPredecessorTables(const std::vector<std::string>& signatures, int threads)
+{
+	bool agree = true;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		vector< PIECE_TYPES> pieces;
+		if (!BuildScheduler::PiecesFromSignature(signatures[i], pieces))
+		{
+			cout << "Error. " << signatures[i] << " is not a set of " << NUM_PIECES << " pieces." << endl;
+			return false;
+		}
+		Checkmate checkmate;
+		string filename = checkmate.MakeFilenameFromPieces(pieces);
+		if (!ifstream(filename + ".table.bin") && !checkmate.CombinedTableExists(pieces))
+		{
+			cout << "Error. There is no " << signatures[i] << " table to check." << endl;
+			agree = false;
+			continue;
+		}
+		checkmate.Initialize(pieces, true);
+		if (!checkmate.CheckPredecessors(threads))
+			agree = false;
+	}
+	return agree;
+}
@@ -0,0 +1,14 @@
+#pragma once
+// Checks the predecessor (unmove) generator against the forward one, on tables on disk:
+//		MakeTables -unmoves WQ WPBP -threads=8
+// For every legal position q of each table, the positions Checkmate::GeneratePredecessors finds
+// must be exactly those whose GenerateSuccessors have q in them: each one once, and no others.
+// Positions that don't agree are printed. See Predecessors.cpp.
+
+#include <string>
+#include <vector>
+
+const int PREDECESSOR_MAX_PRINTED = 20;
+
+// Returns false if any table is missing, or if the generators don't agree on it.
+bool CheckPredecessorTables(const std::vector<std::string>& signatures, int threads);
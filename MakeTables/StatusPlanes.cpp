@@ -0,0 +1,192 @@
+/*
+Status flags as bit planes.
+*/
+#include <iostream>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLANES_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "StatusPlanes.h"
+
+static inline int CountBits(unsigned long long word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(word);
+#elif defined(__GNUC__)
+	return __builtin_popcountll(word);
+#else
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// A bit for each of the 16 bytes at bytes that has any of mask's bits.
+static inline unsigned int AnyBitsLane(const unsigned char* bytes, unsigned char mask)
+{
+#ifdef PLANES_SSE2
+	__m128i masked = _mm_and_si128(_mm_loadu_si128((const __m128i*)bytes), _mm_set1_epi8((char)mask));
+	return ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(masked, _mm_setzero_si128())) & 0xFFFF;
+#else
+	unsigned int bits = 0;
+	for (int i = 0; i < 16; i++)
+		if (bytes[i] & mask)
+			bits |= 1 << i;
+	return bits;
+#endif
+}
+
+// A bit for each of the 16 bytes at bytes that is value.
+static inline unsigned int EqualLane(const char* bytes, char value)
+{
+#ifdef PLANES_SSE2
+	__m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)bytes), _mm_set1_epi8(value));
+	return (unsigned int)_mm_movemask_epi8(equal);
+#else
+	unsigned int bits = 0;
+	for (int i = 0; i < 16; i++)
+		if (bytes[i] == value)
+			bits |= 1 << i;
+	return bits;
+#endif
+}
+
+StatusPlanes::StatusPlanes()
+{
+	mWords = NULL;
+	mPositions = 0;
+	mWordsPerPlane = 0;
+	mPlanes = 0;
+}
+
+StatusPlanes::~StatusPlanes()
+{
+	Free();
+}
+
+void StatusPlanes::Allocate(long long positions, int planes)
+{
+	Free();
+	mPositions = positions;
+	mWordsPerPlane = (positions + 127) / 128 * 2;
+	mPlanes = planes;
+	mWords = (unsigned long long*)AllocateTableMemory(GetBytes(), TABLE_MEMORY::HEAP);
+	Assert(mWords != NULL, "Could not get the memory for the status planes");
+	memset(mWords, 0, (size_t)GetBytes());
+}
+
+void StatusPlanes::Free()
+{
+	if (mWords)
+		FreeTableMemory(mWords);
+	mWords = NULL;
+	mPositions = 0;
+	mWordsPerPlane = 0;
+	mPlanes = 0;
+}
+
+void StatusPlanes::GatherStatus(int plane, const unsigned char* status, unsigned char mask)
+{
+	unsigned long long* words = GetPlane(plane);
+	long long whole = mPositions / 64;
+	for (long long w = 0; w < whole; w++)
+	{
+		const unsigned char* bytes = status + w * 64;
+		words[w] = (unsigned long long)AnyBitsLane(bytes, mask) | (unsigned long long)AnyBitsLane(bytes + 16, mask) << 16 |
+			(unsigned long long)AnyBitsLane(bytes + 32, mask) << 32 | (unsigned long long)AnyBitsLane(bytes + 48, mask) << 48;
+	}
+	for (long long w = whole; w < mWordsPerPlane; w++)
+		words[w] = 0;
+	for (long long p = whole * 64; p < mPositions; p++)
+		if (status[p] & mask)
+			Set(plane, p);
+}
+
+void StatusPlanes::GatherValue(int plane, const char* values, char value)
+{
+	unsigned long long* words = GetPlane(plane);
+	long long whole = mPositions / 64;
+	for (long long w = 0; w < whole; w++)
+	{
+		const char* bytes = values + w * 64;
+		words[w] = (unsigned long long)EqualLane(bytes, value) | (unsigned long long)EqualLane(bytes + 16, value) << 16 |
+			(unsigned long long)EqualLane(bytes + 32, value) << 32 | (unsigned long long)EqualLane(bytes + 48, value) << 48;
+	}
+	for (long long w = whole; w < mWordsPerPlane; w++)
+		words[w] = 0;
+	for (long long p = whole * 64; p < mPositions; p++)
+		if (values[p] == value)
+			Set(plane, p);
+}
+
+long long StatusPlanes::Count(int plane) const
+{
+	const unsigned long long* words = GetPlane(plane);
+	long long count = 0;
+	for (long long w = 0; w < mWordsPerPlane; w++)
+		count += CountBits(words[w]);
+	return count;
+}
+
+long long StatusPlanes::AndCount(int a, int b) const
+{
+	const unsigned long long* wordsA = GetPlane(a);
+	const unsigned long long* wordsB = GetPlane(b);
+	long long count = 0;
+	for (long long w = 0; w < mWordsPerPlane; w++)
+		count += CountBits(wordsA[w] & wordsB[w]);
+	return count;
+}
+
+void StatusPlanes::And(int destination, int a, int b)
+{
+	unsigned long long* out = GetPlane(destination);
+	const unsigned long long* wordsA = GetPlane(a);
+	const unsigned long long* wordsB = GetPlane(b);
+#ifdef PLANES_SSE2
+	for (long long w = 0; w < mWordsPerPlane; w += 2)
+		_mm_storeu_si128((__m128i*)(out + w), _mm_and_si128(
+			_mm_loadu_si128((const __m128i*)(wordsA + w)), _mm_loadu_si128((const __m128i*)(wordsB + w))));
+#else
+	for (long long w = 0; w < mWordsPerPlane; w++)
+		out[w] = wordsA[w] & wordsB[w];
+#endif
+}
+
+void StatusPlanes::Or(int destination, int a, int b)
+{
+	unsigned long long* out = GetPlane(destination);
+	const unsigned long long* wordsA = GetPlane(a);
+	const unsigned long long* wordsB = GetPlane(b);
+#ifdef PLANES_SSE2
+	for (long long w = 0; w < mWordsPerPlane; w += 2)
+		_mm_storeu_si128((__m128i*)(out + w), _mm_or_si128(
+			_mm_loadu_si128((const __m128i*)(wordsA + w)), _mm_loadu_si128((const __m128i*)(wordsB + w))));
+#else
+	for (long long w = 0; w < mWordsPerPlane; w++)
+		out[w] = wordsA[w] | wordsB[w];
+#endif
+}
+
+void StatusPlanes::AndNot(int destination, int a, int b)
+{
+	unsigned long long* out = GetPlane(destination);
+	const unsigned long long* wordsA = GetPlane(a);
+	const unsigned long long* wordsB = GetPlane(b);
+#ifdef PLANES_SSE2
+	// _mm_andnot_si128 is (not first) and second.
+	for (long long w = 0; w < mWordsPerPlane; w += 2)
+		_mm_storeu_si128((__m128i*)(out + w), _mm_andnot_si128(
+			_mm_loadu_si128((const __m128i*)(wordsB + w)), _mm_loadu_si128((const __m128i*)(wordsA + w))));
+#else
+	for (long long w = 0; w < mWordsPerPlane; w++)
+		out[w] = wordsA[w] & ~wordsB[w];
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+// Status flags as bit planes: one bit per position for each flag, instead of S's one byte per
+// position for all of them. A plane is an eighth the size of S, so the one IsLegalPosition reads
+// (Checkmate::mIllegalPlane) stays in the cache far longer, and testing it is one bit test.
+//
+// A plane is gathered from S (or B) in one pass, 64 positions to a word, and planes are counted
+// and combined a word, or with SSE2 two words, at a time, so questions like "legal and in check"
+// are an And and a Count instead of a pass over S.
+// Bits past the last position are always zero, so a plane can be counted without masking them.
+
+#include "TableMemory.h"
+
+class StatusPlanes
+{
+public:
+	StatusPlanes();
+	~StatusPlanes();
+
+	// planes planes of positions bits each, all zero.
+	void Allocate(long long positions, int planes);
+	void Free();
+	bool IsAllocated() const { return mWords != 0; }
+	long long GetBytes() const { return mWordsPerPlane * mPlanes * (long long)sizeof(unsigned long long); }
+
+	bool Test(int plane, long long p) const
+	{
+		return (mWords[plane * mWordsPerPlane + (p >> 6)] >> (p & 63)) & 1;
+	}
+	void Set(int plane, long long p)
+	{
+		mWords[plane * mWordsPerPlane + (p >> 6)] |= 1ULL << (p & 63);
+	}
+
+	// Sets the bit of each position whose status has any of mask's bits, and clears the others.
+	void GatherStatus(int plane, const unsigned char* status, unsigned char mask);
+	// The same for each position whose value is value, like ILLEGAL in a combined table's B.
+	void GatherValue(int plane, const char* values, char value);
+
+	long long Count(int plane) const; // how many bits are set
+	void And(int destination, int a, int b);
+	void Or(int destination, int a, int b);
+	void AndNot(int destination, int a, int b); // a and not b
+	long long AndCount(int a, int b) const; // Count of And, without storing it
+
+private:
+	unsigned long long* mWords; // plane by plane
+	long long mPositions;
+	long long mWordsPerPlane; // even, for SSE2
+	int mPlanes;
+
+	unsigned long long* GetPlane(int plane) { return mWords + plane * mWordsPerPlane; }
+	const unsigned long long* GetPlane(int plane) const { return mWords + plane * mWordsPerPlane; }
+};
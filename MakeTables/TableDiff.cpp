@@ -0,0 +1,301 @@
+/*
+Table diff.
+*/
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIFF_SSE2
+#include <emmintrin.h>
+#endif
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "TableDiff.h"
+
+enum class DIFF_KIND { ILLEGAL, UNKNOWN, DRAW, ZERO, WHITE_WINS, BLACK_WINS };
+const int DIFF_KIND_COUNT = 6;
+static const char gDiffKindNames[DIFF_KIND_COUNT][12] = {
+		"illegal", "unknown", "draw", "checkmate", "White wins", "Black wins"};
+
+static DIFF_KIND KindOf(char value)
+{
+	if (value == ILLEGAL)
+		return DIFF_KIND::ILLEGAL;
+	if (value == UNKNOWN)
+		return DIFF_KIND::UNKNOWN;
+	if (value == UNFORCEABLE || value == STALEMATE_DRAW || value == INSUFFICIENT_MATERIAL_DRAW)
+		return DIFF_KIND::DRAW;
+	if (value == 0)
+		return DIFF_KIND::ZERO;
+	return value > 0 ? DIFF_KIND::WHITE_WINS : DIFF_KIND::BLACK_WINS;
+}
+
+struct DIFF_COUNTS
+{
+	long long differ;
+	long long kinds[DIFF_KIND_COUNT][DIFF_KIND_COUNT]; // [first file][second file]
+	long long values[256]; // by the value in the first file, as an unsigned char
+	long long bits[8]; // status files
+	vector<long long> kingPairs; // black king * KING_SQUARES + white king
+	vector<long long> first; // indices
+	bool status; // status files, printed as unsigned
+	bool decodable; // the files have at least as many positions as this program's tables
+	long long positions; // bytes after this are a footer, like the combined table's statistics
+	long long footer; // footer bytes that differ
+	INDEX_LAYOUT layout; // from the files' footers
+};
+
+// True if the DIFF_LANE_BYTES at a and b are the same.
+static inline bool SameLane(const char* a, const char* b)
+{
+#ifdef DIFF_SSE2
+	__m128i d0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b));
+	__m128i d1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + 16)), _mm_loadu_si128((const __m128i*)(b + 16)));
+	__m128i d2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + 32)), _mm_loadu_si128((const __m128i*)(b + 32)));
+	__m128i d3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + 48)), _mm_loadu_si128((const __m128i*)(b + 48)));
+	__m128i d = _mm_or_si128(_mm_or_si128(d0, d1), _mm_or_si128(d2, d3));
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(d, _mm_setzero_si128())) == 0xFFFF;
+#else
+	return memcmp(a, b, DIFF_LANE_BYTES) == 0;
+#endif
+}
+
+static void CountDifference(DIFF_COUNTS& counts, long long index, char a, char b, bool status, long long positionsPerKingPair, int firstPositions)
+{
+	counts.differ++;
+	if (index >= counts.positions)
+	{
+		counts.footer++;
+		return;
+	}
+	if (status)
+	{
+		unsigned char changed = (unsigned char)(a ^ b);
+		for (int bit = 0; bit < 8; bit++)
+			if (changed & (1 << bit))
+				counts.bits[bit]++;
+	}
+	else
+	{
+		counts.kinds[(int)KindOf(a)][(int)KindOf(b)]++;
+		counts.values[(unsigned char)a]++;
+	}
+	if (positionsPerKingPair > 0 && counts.layout == INDEX_LAYOUT::TURN_INTERLEAVED)
+		counts.kingPairs[index / (2 * positionsPerKingPair)]++;
+	else if (positionsPerKingPair > 0)
+		counts.kingPairs[(index / positionsPerKingPair) % (KING_SQUARES * KING_SQUARES)]++;
+	if ((int)counts.first.size() < firstPositions)
+		counts.first.push_back(index);
+}
+
+static long long FileSize(ifstream& fin)
+{
+	fin.seekg(0, ios::end);
+	long long size = (long long)fin.tellg();
+	fin.seekg(0, ios::beg);
+	return size;
+}
+
+// TURN_INTERLEAVED if the file ends with its index footer (see INDEX_LAYOUT), or else TURN_MAJOR.
+static INDEX_LAYOUT ReadIndexLayout(ifstream& fin, long long size, long long totalPositions)
+{
+	INDEX_LAYOUT layout = INDEX_LAYOUT::TURN_MAJOR;
+	long long footer[2];
+	char magic[8];
+	if (size >= totalPositions + INDEX_FOOTER_BYTES)
+	{
+		fin.seekg(size - INDEX_FOOTER_BYTES);
+		if (fin.read((char*)footer, sizeof(footer)) && fin.read(magic, 8) &&
+			memcmp(magic, INDEX_FOOTER_MAGIC, 8) == 0 && footer[1] == 1 && footer[0] == INDEX_SCHEME_INTERLEAVED)
+			layout = INDEX_LAYOUT::TURN_INTERLEAVED;
+	}
+	fin.clear();
+	fin.seekg(0, ios::beg);
+	return layout;
+}
+
+// Compares the files a block at a time. Returns false if they can't be read.
+static bool CountDifferences(const string& filename1, const string& filename2, bool status, int firstPositions, DIFF_COUNTS& counts)
+{
+	ifstream fin1(filename1, ios::binary);
+	ifstream fin2(filename2, ios::binary);
+	if (!fin1 || !fin2)
+	{
+		cout << "Error. Could not open " << (!fin1 ? filename1 : filename2) << endl;
+		return false;
+	}
+	long long size = FileSize(fin1);
+	long long size2 = FileSize(fin2);
+	long long totalPositions = 2LL * KING_SQUARES * KING_SQUARES;
+	for (int i = 2; i < NUM_PIECES; i++)
+		totalPositions *= OTHER_SQUARES;
+	// Only footers can be different sizes.
+	if (size != size2 && (size < totalPositions || size2 < totalPositions))
+	{
+		cout << "Error. " << filename1 << " has " << size << " bytes, and " << filename2 << " has " << size2 << endl;
+		return false;
+	}
+	INDEX_LAYOUT layout = ReadIndexLayout(fin1, size, totalPositions);
+	if (layout != ReadIndexLayout(fin2, size2, totalPositions))
+	{
+		cout << "Error. " << filename1 << " and " << filename2 << " have different index layouts." << endl;
+		return false;
+	}
+	long long extra = max(size, size2) - min(size, size2);
+	size = min(size, size2);
+	long long positionsPerKingPair = (size >= totalPositions) ? totalPositions / (2LL * KING_SQUARES * KING_SQUARES) : 0;
+
+	memset(counts.kinds, 0, sizeof(counts.kinds));
+	memset(counts.values, 0, sizeof(counts.values));
+	memset(counts.bits, 0, sizeof(counts.bits));
+	counts.status = status;
+	counts.layout = layout;
+	counts.decodable = positionsPerKingPair > 0;
+	counts.positions = counts.decodable ? totalPositions : size;
+	counts.footer = extra;
+	counts.differ = extra;
+	counts.kingPairs.assign(KING_SQUARES * KING_SQUARES, 0);
+	counts.first.clear();
+
+	vector<char> block1((size_t)min(size, DIFF_BLOCK_BYTES));
+	vector<char> block2(block1.size());
+	for (long long start = 0; start < size; start += DIFF_BLOCK_BYTES)
+	{
+		long long bytes = min(DIFF_BLOCK_BYTES, size - start);
+		if (!fin1.read(block1.data(), bytes) || !fin2.read(block2.data(), bytes))
+		{
+			cout << "Error. Could not read " << (!fin1 ? filename1 : filename2) << endl;
+			return false;
+		}
+		const char* a = block1.data();
+		const char* b = block2.data();
+		long long i = 0;
+		for (; i + DIFF_LANE_BYTES <= bytes; i += DIFF_LANE_BYTES)
+		{
+			if (SameLane(a + i, b + i))
+				continue;
+			for (int j = 0; j < DIFF_LANE_BYTES; j++)
+				if (a[i + j] != b[i + j])
+					CountDifference(counts, start + i + j, a[i + j], b[i + j], status, positionsPerKingPair, firstPositions);
+		}
+		for (; i < bytes; i++)
+			if (a[i] != b[i])
+				CountDifference(counts, start + i, a[i], b[i], status, positionsPerKingPair, firstPositions);
+	}
+
+	cout << "\n" << filename1 << " and " << filename2 << ": " << counts.positions << " positions, " << counts.differ - counts.footer << " differ." << endl;
+	if (counts.footer > 0)
+		cout << counts.footer << " bytes of the footer after the positions differ." << endl;
+	if (counts.differ == counts.footer)
+		return true;
+
+	if (status)
+	{
+		cout << "Bits changed:" << endl;
+		for (int bit = 0; bit < 8; bit++)
+			if (counts.bits[bit] > 0)
+				cout << "  " << (1 << bit) << ": " << counts.bits[bit] << endl;
+	}
+	else
+	{
+		cout << "By kind (first file -> second file):" << endl;
+		for (int k1 = 0; k1 < DIFF_KIND_COUNT; k1++)
+			for (int k2 = 0; k2 < DIFF_KIND_COUNT; k2++)
+				if (counts.kinds[k1][k2] > 0)
+					cout << "  " << gDiffKindNames[k1] << " -> " << gDiffKindNames[k2] << ": " << counts.kinds[k1][k2] << endl;
+		long long wins = 0;
+		for (int k = 0; k < DIFF_KIND_COUNT; k++)
+			wins += counts.kinds[(int)DIFF_KIND::WHITE_WINS][k] + counts.kinds[(int)DIFF_KIND::BLACK_WINS][k];
+		if (wins > 0)
+			cout << "Wins by value in the first file:" << endl;
+		for (int v = 1; v <= POSITIVE_OVERFLOW; v++)
+		{
+			if (counts.values[v] > 0)
+				cout << "  White in " << v << (v == POSITIVE_OVERFLOW ? " or more" : "") << ": " << counts.values[v] << endl;
+			if (counts.values[(unsigned char)(char)-v] > 0)
+				cout << "  Black in " << v << (v == POSITIVE_OVERFLOW ? " or more" : "") << ": " << counts.values[(unsigned char)(char)-v] << endl;
+		}
+	}
+
+	if (counts.decodable)
+	{
+		vector< pair<long long, int> > pairs;
+		for (int k = 0; k < KING_SQUARES * KING_SQUARES; k++)
+			if (counts.kingPairs[k] > 0)
+				pairs.push_back(make_pair(counts.kingPairs[k], k));
+		sort(pairs.rbegin(), pairs.rend());
+		cout << pairs.size() << " king pairs have differences. The most:" << endl;
+		for (unsigned int p = 0; p < pairs.size() && p < (unsigned int)DIFF_KING_PAIRS_SHOWN; p++)
+			cout << "  black king " << pairs[p].second / KING_SQUARES << ", white king " << pairs[p].second % KING_SQUARES
+				<< ": " << pairs[p].first << endl;
+	}
+	return true;
+}
+
+// Prints the first positions that differ, with their values in both files.
+static void PrintFirstDifferences(const string& filename1, const string& filename2, const DIFF_COUNTS& counts)
+{
+	if (counts.first.empty())
+		return;
+	ifstream fin1(filename1, ios::binary);
+	ifstream fin2(filename2, ios::binary);
+	Checkmate checkmate;
+	checkmate.SetIndexLayout(counts.layout);
+	cout << "The first " << counts.first.size() << " that differ:" << endl;
+	for (unsigned int i = 0; i < counts.first.size(); i++)
+	{
+		char a = 0;
+		char b = 0;
+		fin1.seekg(counts.first[i]);
+		fin1.read(&a, 1);
+		fin2.seekg(counts.first[i]);
+		fin2.read(&b, 1);
+		if (counts.status)
+			cout << "  " << counts.first[i] << ": " << (int)(unsigned char)a << ", not " << (int)(unsigned char)b << "  ";
+		else
+			cout << "  " << counts.first[i] << ": " << (int)a << ", not " << (int)b << "  ";
+		if (counts.decodable)
+		{
+			int positions[POSITION_ARRAY_SIZE];
+			checkmate.FromIndex((int)counts.first[i], positions);
+			checkmate.PrintPosition(positions);
+		}
+		else
+			cout << endl;
+	}
+}
+
+static string StatusFilename(const string& filename)
+{
+	string suffix = ".table.bin";
+	if (filename.size() < suffix.size() || filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) != 0)
+		return "";
+	return filename.substr(0, filename.size() - suffix.size()) + ".status.bin";
+}
+
+bool DiffTables(const std::string& filename1, const std::string& filename2, bool status, int firstPositions)
+{
+	DIFF_COUNTS counts;
+	if (!CountDifferences(filename1, filename2, false, firstPositions, counts))
+		return false;
+	bool same = counts.differ == 0;
+	PrintFirstDifferences(filename1, filename2, counts);
+
+	if (status)
+	{
+		string status1 = StatusFilename(filename1);
+		string status2 = StatusFilename(filename2);
+		if (status1.empty() || status2.empty())
+		{
+			cout << "Error. -status needs two .table.bin files." << endl;
+			return false;
+		}
+		if (!CountDifferences(status1, status2, true, firstPositions, counts))
+			return false;
+		same = same && counts.differ == 0;
+		PrintFirstDifferences(status1, status2, counts);
+	}
+	return same;
+}
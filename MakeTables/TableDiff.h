@@ -0,0 +1,30 @@
+#pragma once
+// Compares two table files, for example the same table from before and after a change:
+//		MakeTables -diff old\WBWN.table.bin ..\MakeTables\WBWN.table.bin -status -first=20
+// Works on .table.bin, .combined.bin and .dtz.bin files, or any two files of one byte per position.
+// With -status, the .status.bin files next to two .table.bin files are compared too. Those two are
+// only saved with -legacyfiles.
+//
+// Prints how many positions differ, then:
+//	by kind: what the first file has where they differ (illegal, unknown, draw, checkmate, or a
+//		win for either side), against what the second has.
+//	by value: for wins, how many differ at each count in the first file.
+//	by kings: the king squares with the most differences.
+//	the first -first positions that differ (default DIFF_FIRST_POSITIONS), decoded.
+// For status files, how many positions have each bit changed.
+//
+// The files are read DIFF_BLOCK_BYTES at a time, and each block is compared DIFF_LANE_BYTES at
+// a time with SSE2 where there is SSE2, so only the few places that differ are looked at closely.
+// The positions are only decoded if the files have at least as many positions as this program's
+// tables. Anything after them, like the statistics at the end of a combined table, is only counted.
+// Both files need the same INDEX_LAYOUT, which is read from their footers.
+
+#include <string>
+
+const long long DIFF_BLOCK_BYTES = 16 * 1024 * 1024;
+const int DIFF_LANE_BYTES = 64;
+const int DIFF_FIRST_POSITIONS = 10;
+const int DIFF_KING_PAIRS_SHOWN = 16;
+
+// Returns false if the files can't be read or aren't the same size, or if they differ.
+bool DiffTables(const std::string& filename1, const std::string& filename2, bool status, int firstPositions);
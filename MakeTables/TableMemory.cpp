@@ -0,0 +1,405 @@
+/*
+Allocation for the big per-position arrays.
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <new>
+#include <vector>
+#include <map>
+#include <mutex>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "TableMemory.h"
+
+const long long TRANSPARENT_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Everything not made with new[] is remembered here, so FreeTableMemory knows how to release it.
+struct TABLE_MAPPING
+{
+	void* base; // what was really mapped. The memory handed out may start after it, for alignment.
+	long long mappedBytes;
+	long long hugePageSize; // of EXPLICIT huge pages, or 0
+#ifdef _WIN32
+	HANDLE file; // NULL unless FILE_BACKED
+	HANDLE mapping;
+#else
+	int fd; // -1 unless FILE_BACKED
+#endif
+};
+
+static std::map<void*, TABLE_MAPPING> gMappings;
+static std::mutex gMappingsLock;
+
+static long long GetPageSize()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static void RememberMapping(void* memory, const TABLE_MAPPING& mapping)
+{
+	std::lock_guard<std::mutex> guard(gMappingsLock);
+	gMappings[memory] = mapping;
+}
+
+#ifndef _WIN32
+
+// The values from linux/mempolicy.h. We call mbind directly, so libnuma isn't needed.
+const int MEMORY_POLICY_BIND = 2;
+const int MEMORY_POLICY_INTERLEAVE = 3;
+const unsigned int MEMORY_POLICY_MOVE = 2;
+const int MAX_NUMA_NODES = 1024;
+
+// Reads a list like "0-3,8,10-11" from /sys into the numbers it names.
+static bool ReadSysList(const std::string& filename, std::vector<int>& numbers)
+{
+	std::ifstream file(filename);
+	std::string list;
+	if (!(file >> list))
+		return false;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		size_t dash = item.find('-');
+		int first = std::stoi(item.substr(0, dash));
+		int last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+		for (int n = first; n <= last; n++)
+			numbers.push_back(n);
+	}
+	return true;
+}
+
+static bool SetMemoryPolicy(void* start, long long bytes, int mode, const std::vector<int>& nodes, unsigned int flags)
+{
+	unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = { 0 };
+	for (unsigned int i = 0; i < nodes.size(); i++)
+		if (nodes[i] < MAX_NUMA_NODES)
+			mask[nodes[i] / (8 * sizeof(unsigned long))] |= 1UL << (nodes[i] % (8 * sizeof(unsigned long)));
+	return syscall(SYS_mbind, start, (unsigned long)bytes, mode, mask, (unsigned long)MAX_NUMA_NODES + 1, flags) == 0;
+}
+
+static long long GetExplicitHugePageSize()
+{
+	std::ifstream meminfo("/proc/meminfo");
+	std::string name;
+	long long kilobytes;
+	while (meminfo >> name)
+	{
+		if (name == "Hugepagesize:" && meminfo >> kilobytes)
+			return kilobytes * 1024;
+		meminfo.ignore(1000, '\n');
+	}
+	return TRANSPARENT_HUGE_PAGE_SIZE;
+}
+
+// Anonymous memory for HEAP (private) or SHARED, with huge pages and a NUMA policy if asked for.
+static void* AllocateAnonymous(long long bytes, bool shared, HUGE_PAGES hugePages, NUMA_POLICY numaPolicy)
+{
+	int flags = MAP_ANONYMOUS | (shared ? MAP_SHARED : MAP_PRIVATE);
+	TABLE_MAPPING mapping;
+	mapping.fd = -1;
+	mapping.hugePageSize = 0;
+	void* memory = MAP_FAILED;
+
+	if (hugePages == HUGE_PAGES::EXPLICIT)
+	{
+		long long hugePageSize = GetExplicitHugePageSize();
+		mapping.mappedBytes = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+		memory = mmap(NULL, (size_t)mapping.mappedBytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED)
+		{
+			mapping.base = memory;
+			mapping.hugePageSize = hugePageSize;
+		}
+		else
+			std::cout << "No explicit huge pages for " << bytes << " bytes (see vm.nr_hugepages). Trying transparent huge pages." << std::endl;
+	}
+
+	if (memory == MAP_FAILED)
+	{
+		// Extra room to line up on a huge page boundary. Transparent huge pages need that.
+		long long alignment = (hugePages == HUGE_PAGES::NONE) ? 0 : TRANSPARENT_HUGE_PAGE_SIZE;
+		mapping.mappedBytes = bytes + alignment;
+		mapping.base = mmap(NULL, (size_t)mapping.mappedBytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (mapping.base == MAP_FAILED)
+			return NULL;
+		memory = mapping.base;
+		if (alignment)
+		{
+			memory = (void*)(((unsigned long long)mapping.base + alignment - 1) / alignment * alignment);
+			madvise(memory, (size_t)bytes, MADV_HUGEPAGE);
+		}
+	}
+
+	if (numaPolicy == NUMA_POLICY::INTERLEAVE && GetNumaNodeCount() > 1)
+	{
+		std::vector<int> nodes;
+		ReadSysList("/sys/devices/system/node/online", nodes);
+		if (!SetMemoryPolicy(memory, bytes, MEMORY_POLICY_INTERLEAVE, nodes, 0))
+			std::cout << "Could not interleave " << bytes << " bytes over the NUMA nodes." << std::endl;
+	}
+
+	RememberMapping(memory, mapping);
+	return memory;
+}
+
+#else
+
+// Large pages need the "Lock pages in memory" privilege. Without it, this returns NULL.
+static void* AllocateLargePages(long long bytes)
+{
+	long long largePageSize = GetLargePageMinimum();
+	if (largePageSize == 0)
+		return NULL;
+	TABLE_MAPPING mapping;
+	mapping.file = NULL;
+	mapping.mapping = NULL;
+	mapping.hugePageSize = largePageSize;
+	mapping.mappedBytes = (bytes + largePageSize - 1) / largePageSize * largePageSize;
+	mapping.base = VirtualAlloc(NULL, (SIZE_T)mapping.mappedBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	if (mapping.base == NULL)
+	{
+		std::cout << "No large pages for " << bytes << " bytes (needs the Lock pages in memory privilege)." << std::endl;
+		return NULL;
+	}
+	RememberMapping(mapping.base, mapping);
+	return mapping.base;
+}
+
+#endif
+
+static void* AllocateFileBacked(long long bytes, const std::string& backingFile)
+{
+	TABLE_MAPPING fileMapping;
+	fileMapping.mappedBytes = bytes;
+	fileMapping.hugePageSize = 0;
+#ifdef _WIN32
+	fileMapping.file = CreateFileA(backingFile.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (fileMapping.file == INVALID_HANDLE_VALUE)
+		return NULL;
+	fileMapping.mapping = CreateFileMappingA(fileMapping.file, NULL, PAGE_READWRITE, (DWORD)(bytes >> 32), (DWORD)bytes, NULL);
+	if (fileMapping.mapping == NULL)
+	{
+		CloseHandle(fileMapping.file);
+		return NULL;
+	}
+	void* memory = MapViewOfFile(fileMapping.mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)bytes);
+	if (memory == NULL)
+	{
+		CloseHandle(fileMapping.mapping);
+		CloseHandle(fileMapping.file);
+		return NULL;
+	}
+#else
+	fileMapping.fd = open(backingFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fileMapping.fd < 0)
+		return NULL;
+	unlink(backingFile.c_str()); // the space goes away when the fd is closed, even after a crash.
+	if (ftruncate(fileMapping.fd, bytes) != 0)
+	{
+		close(fileMapping.fd);
+		return NULL;
+	}
+	void* memory = mmap(NULL, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileMapping.fd, 0);
+	if (memory == MAP_FAILED)
+	{
+		close(fileMapping.fd);
+		return NULL;
+	}
+#endif
+	fileMapping.base = memory;
+	RememberMapping(memory, fileMapping);
+	return memory;
+}
+
+void* AllocateTableMemory(long long bytes, TABLE_MEMORY kind, const std::string& backingFile,
+	HUGE_PAGES hugePages, NUMA_POLICY numaPolicy)
+{
+	if (kind == TABLE_MEMORY::FILE_BACKED)
+		return AllocateFileBacked(bytes, backingFile);
+#ifndef _WIN32
+	if (kind == TABLE_MEMORY::SHARED || hugePages != HUGE_PAGES::NONE || numaPolicy != NUMA_POLICY::NONE)
+		return AllocateAnonymous(bytes, kind == TABLE_MEMORY::SHARED, hugePages, numaPolicy);
+#else
+	if (hugePages == HUGE_PAGES::EXPLICIT)
+	{
+		void* memory = AllocateLargePages(bytes);
+		if (memory != NULL)
+			return memory;
+	}
+#endif
+	return new (std::nothrow) char[bytes];
+}
+
+void FreeTableMemory(void* memory)
+{
+	if (memory == NULL)
+		return;
+
+	std::lock_guard<std::mutex> guard(gMappingsLock);
+	std::map<void*, TABLE_MAPPING>::iterator found = gMappings.find(memory);
+	if (found == gMappings.end())
+	{
+		delete[] (char*)memory;
+		return;
+	}
+	TABLE_MAPPING mapping = found->second;
+	gMappings.erase(found);
+#ifdef _WIN32
+	if (mapping.file == NULL)
+		VirtualFree(mapping.base, 0, MEM_RELEASE);
+	else
+	{
+		UnmapViewOfFile(mapping.base);
+		CloseHandle(mapping.mapping);
+		CloseHandle(mapping.file);
+	}
+#else
+	munmap(mapping.base, (size_t)mapping.mappedBytes);
+	if (mapping.fd >= 0)
+		close(mapping.fd);
+#endif
+}
+
+void ReleaseTableMemoryRange(void* memory, long long offset, long long bytes, TABLE_MEMORY kind)
+{
+	if (kind != TABLE_MEMORY::FILE_BACKED || bytes <= 0)
+		return;
+
+	// Only whole pages inside the range can be released.
+	long long pageSize = GetPageSize();
+	long long first = (offset + pageSize - 1) / pageSize * pageSize;
+	long long last = (offset + bytes) / pageSize * pageSize;
+	if (last <= first)
+		return;
+	char* start = (char*)memory + first;
+	size_t length = (size_t)(last - first);
+
+#ifdef _WIN32
+	FlushViewOfFile(start, length);
+	VirtualUnlock(start, length); // on pages that were never locked, this trims them from the working set.
+#else
+	// After this the pages are only in the file cache, which the kernel can always reclaim.
+	// No lock is taken here, since partition workers call this after fork.
+	msync(start, length, MS_SYNC);
+	madvise(start, length, MADV_DONTNEED);
+#endif
+}
+
+void ReportTableMemoryPages(const char* name, void* memory, long long bytes)
+{
+	if (memory == NULL)
+		return;
+	long long hugePageSize = 0;
+	{
+		std::lock_guard<std::mutex> guard(gMappingsLock);
+		std::map<void*, TABLE_MAPPING>::iterator found = gMappings.find(memory);
+		if (found != gMappings.end())
+			hugePageSize = found->second.hugePageSize;
+	}
+	std::cout << name << ": ";
+	if (hugePageSize)
+	{
+		std::cout << hugePageSize / 1024 << " KB explicit huge pages" << std::endl;
+		return;
+	}
+
+	long long hugeBytes = 0;
+#ifndef _WIN32
+	// Add up the transparent huge pages of every mapping that overlaps the memory.
+	unsigned long long begin = (unsigned long long)memory;
+	unsigned long long end = begin + bytes;
+	std::ifstream smaps("/proc/self/smaps");
+	std::string line;
+	bool overlaps = false;
+	while (std::getline(smaps, line))
+	{
+		unsigned long long vmaBegin, vmaEnd;
+		char dash;
+		std::stringstream ss(line);
+		if (line.find(':') > line.find(' ') && ss >> std::hex >> vmaBegin >> dash >> vmaEnd && dash == '-')
+		{
+			overlaps = vmaBegin < end && vmaEnd > begin;
+			continue;
+		}
+		std::string field;
+		long long kilobytes;
+		ss.clear();
+		ss.str(line);
+		if (overlaps && ss >> field >> std::dec >> kilobytes &&
+				(field == "AnonHugePages:" || field == "ShmemPmdMapped:" || field == "FilePmdMapped:"))
+			hugeBytes += kilobytes * 1024;
+	}
+#endif
+	if (hugeBytes)
+		std::cout << TRANSPARENT_HUGE_PAGE_SIZE / 1024 << " KB transparent huge pages for "
+			<< (int)(100.0 * hugeBytes / bytes) << "%, the rest " << GetPageSize() / 1024 << " KB pages" << std::endl;
+	else
+		std::cout << GetPageSize() / 1024 << " KB pages" << std::endl;
+}
+
+#ifndef _WIN32
+
+int GetNumaNodeCount()
+{
+	std::vector<int> nodes;
+	if (!ReadSysList("/sys/devices/system/node/online", nodes) || nodes.empty())
+		return 1;
+	return nodes.back() + 1;
+}
+
+void BindTableMemoryRange(void* memory, long long offset, long long bytes, int node)
+{
+	// Pages can't be split, so a page on the edge goes with one of its neighbors.
+	long long pageSize = GetPageSize();
+	long long first = offset / pageSize * pageSize;
+	long long last = (offset + bytes + pageSize - 1) / pageSize * pageSize;
+	std::vector<int> nodes(1, node);
+	if (!SetMemoryPolicy((char*)memory + first, last - first, MEMORY_POLICY_BIND, nodes, MEMORY_POLICY_MOVE))
+		std::cout << "Could not move " << bytes << " bytes to NUMA node " << node << std::endl;
+}
+
+bool RunProcessOnNumaNode(int processId, int node)
+{
+	std::vector<int> cpus;
+	if (!ReadSysList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpus))
+		return false;
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (unsigned int i = 0; i < cpus.size(); i++)
+		CPU_SET(cpus[i], &cpuSet);
+	return sched_setaffinity(processId, sizeof(cpuSet), &cpuSet) == 0;
+}
+
+#else
+
+int GetNumaNodeCount()
+{
+	return 1;
+}
+
+void BindTableMemoryRange(void*, long long, long long, int)
+{
+}
+
+bool RunProcessOnNumaNode(int, int)
+{
+	return false;
+}
+
+#endif
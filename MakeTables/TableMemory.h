@@ -0,0 +1,54 @@
+#pragma once
+// Allocation for the big per-position arrays (B, S, and the legal moves cache).
+//
+// HEAP is plain new[].
+// SHARED memory stays shared with child processes after fork, so partition workers
+// (see PartitionedSolver.cpp) can all write into the same B and S.
+// On Windows there is no fork, so SHARED falls back to HEAP.
+// FILE_BACKED memory is a mapping of a scratch file, for tables bigger than RAM (out-of-core).
+// The operating system pages it in and out as needed, and the pages are always reclaimable,
+// so a memory limit slows the build down instead of killing it. The scratch file is deleted
+// when the memory is freed. It is also shared with child processes after fork.
+//
+// The solver reads B and S at random successor indices, so with 4 KB pages almost every read
+// is a TLB miss. HUGE_PAGES asks for bigger pages for HEAP and SHARED memory:
+//		TRANSPARENT lines the memory up on 2 MB and asks the kernel to use huge pages when it can.
+//		EXPLICIT takes pages from the reserved huge page pool (vm.nr_hugepages on Linux,
+//			large pages with SeLockMemoryPrivilege on Windows), or falls back to TRANSPARENT.
+// ReportTableMemoryPages says what was really obtained.
+//
+// NUMA_POLICY says which memory node the pages go on, on machines with more than one:
+//		INTERLEAVE spreads the pages over all nodes, so no one node is the bottleneck.
+//		PARTITIONED puts each partition worker's range on that worker's node, and runs the worker
+//			there (see StartPartitionWorkers). Until then the pages go where they are first touched.
+// NUMA_POLICY is only done on Linux.
+
+#include <string>
+
+enum class TABLE_MEMORY {
+		HEAP, SHARED, FILE_BACKED};
+enum class HUGE_PAGES {
+		NONE, TRANSPARENT, EXPLICIT};
+enum class NUMA_POLICY {
+		NONE, INTERLEAVE, PARTITIONED};
+
+// Returns NULL if the memory isn't available.
+// backingFile is only used for FILE_BACKED. FILE_BACKED memory ignores hugePages and numaPolicy.
+void* AllocateTableMemory(long long bytes, TABLE_MEMORY kind, const std::string& backingFile = "",
+	HUGE_PAGES hugePages = HUGE_PAGES::NONE, NUMA_POLICY numaPolicy = NUMA_POLICY::NONE);
+void FreeTableMemory(void* memory);
+
+// For FILE_BACKED memory, writes the given bytes back to the scratch file and drops them from
+// resident memory. They are read back in if touched again. Does nothing for other kinds.
+void ReleaseTableMemoryRange(void* memory, long long offset, long long bytes, TABLE_MEMORY kind);
+
+// Prints the page size the memory really got. Call after the memory has been touched,
+// because transparent huge pages are only handed out then.
+void ReportTableMemoryPages(const char* name, void* memory, long long bytes);
+
+// 1 on machines without NUMA, or where it isn't supported.
+int GetNumaNodeCount();
+// Moves the pages of the given bytes to node, and keeps them there.
+void BindTableMemoryRange(void* memory, long long offset, long long bytes, int node);
+// Makes the process run only on the processors of node. Returns false if it couldn't.
+bool RunProcessOnNumaNode(int processId, int node);
@@ -0,0 +1,293 @@
+/*
+Table statistics.
+*/
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "TableStats.h"
+
+TABLE_STATS::TABLE_STATS()
+{
+	Clear();
+}
+
+void TABLE_STATS::Clear()
+{
+	total = 0;
+	illegal = 0;
+	whiteCheckmates = 0;
+	blackCheckmates = 0;
+	whiteKnownMates = 0;
+	blackKnownMates = 0;
+	fill(insufficientMaterial, insufficientMaterial + STATS_IN_X_COUNTS, 0);
+	fill(stalemate, stalemate + STATS_IN_X_COUNTS, 0);
+	unknown = 0;
+	unforceable = 0;
+	mateInX.assign(POSITIVE_OVERFLOW, 0);
+	responseMateInX.assign(POSITIVE_OVERFLOW, 0);
+}
+
+void TABLE_STATS::Add(const TABLE_STATS& other)
+{
+	total += other.total;
+	illegal += other.illegal;
+	whiteCheckmates += other.whiteCheckmates;
+	blackCheckmates += other.blackCheckmates;
+	whiteKnownMates += other.whiteKnownMates;
+	blackKnownMates += other.blackKnownMates;
+	for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+	{
+		insufficientMaterial[i] += other.insufficientMaterial[i];
+		stalemate[i] += other.stalemate[i];
+	}
+	unknown += other.unknown;
+	unforceable += other.unforceable;
+	if (other.mateInX.size() > mateInX.size())
+	{
+		mateInX.resize(other.mateInX.size(), 0);
+		responseMateInX.resize(other.mateInX.size(), 0);
+	}
+	for (unsigned int x = 0; x < other.mateInX.size(); x++)
+	{
+		mateInX[x] += other.mateInX[x];
+		responseMateInX[x] += other.responseMateInX[x];
+	}
+}
+
+void TABLE_STATS::AddMate(int x, bool whiteToMove)
+{
+	if (x >= (int)mateInX.size())
+	{
+		mateInX.resize(x + 1, 0);
+		responseMateInX.resize(x + 1, 0);
+	}
+	if (whiteToMove)
+		mateInX[x]++;
+	else
+		responseMateInX[x]++;
+}
+
+int TABLE_STATS::GetHighestX() const
+{
+	int highestX = 1;
+	for (int x = 1; x < (int)mateInX.size(); x++)
+		if (mateInX[x] != 0 || responseMateInX[x] != 0)
+			highestX = x;
+	return highestX;
+}
+
+void TABLE_STATS::Print() const
+{
+	int stringWidth = 30;
+	int countWidth = 10;
+	cout << endl;
+	cout << setw(stringWidth) << "totalCount = " << setw(countWidth) << total << endl;
+	cout << setw(stringWidth) << "illegalCount = " << setw(countWidth) << illegal << endl;
+
+	cout << setw(stringWidth) << "whiteCheckmateCount = " << setw(countWidth) << whiteCheckmates << endl;
+	cout << setw(stringWidth) << "blackCheckmateCount = " << setw(countWidth) << blackCheckmates << endl;
+	cout << setw(stringWidth) << "whiteKnownMateCount = " << setw(countWidth) << whiteKnownMates << endl;
+	cout << setw(stringWidth) << "blackKnownMateCount = " << setw(countWidth) << blackKnownMates << endl;
+
+	int highestX = GetHighestX();
+	for (int c = 1; c <= highestX; c++)
+		cout << setw(stringWidth - to_string(c).size() - 3) << "Mate in " << c << " = " << setw(countWidth) << mateInX[c] << endl;
+	for (int c = 1; c <= highestX; c++)
+		cout << setw(stringWidth - to_string(c).size() - 3) << "Response Mate in " << c << " = " << setw(countWidth) << responseMateInX[c] << endl;
+
+	cout << setw(stringWidth) << "insufficientMaterialCount = " << setw(countWidth) << insufficientMaterial[0] << endl;
+	cout << setw(stringWidth) << "insufficientIn1Count = " << setw(countWidth) << insufficientMaterial[1] << endl;
+	cout << setw(stringWidth) << "insufficientIn2Count = " << setw(countWidth) << insufficientMaterial[2] << endl;
+	cout << setw(stringWidth) << "insufficientIn3Count = " << setw(countWidth) << insufficientMaterial[3] << endl;
+	cout << endl;
+	cout << setw(stringWidth) << "stalemateCount = " << setw(countWidth) << stalemate[0] << endl;
+	cout << setw(stringWidth) << "stalemateIn1Count = " << setw(countWidth) << stalemate[1] << endl;
+	cout << setw(stringWidth) << "stalemateIn2Count = " << setw(countWidth) << stalemate[2] << endl;
+	cout << setw(stringWidth) << "stalemateIn3Count = " << setw(countWidth) << stalemate[3] << endl;
+	cout << endl;
+	cout << setw(stringWidth) << "unknownMate = " << setw(countWidth) << unknown << endl;
+	cout << setw(stringWidth) << "Unforceable = " << setw(countWidth) << unforceable << endl;
+
+	long long rest = total - illegal - whiteCheckmates - blackCheckmates - whiteKnownMates - blackKnownMates;
+	for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+		rest -= stalemate[i] + insufficientMaterial[i];
+	cout << endl << "totalCount - illegalCount - whiteCheckmateCount - blackCheckmateCount" << endl;
+	cout << "- whiteKnownMateCount - blackKnownMateCount" << endl;
+	cout << "- variousStalemateCounts -insufficientMaterialCount: " << rest << endl;
+	cout << endl;
+}
+
+bool TABLE_STATS::Write(const std::string& filename, const std::string& signature, STATS_FORMAT format) const
+{
+	ofstream fout(filename);
+	int highestX = GetHighestX();
+	if (format == STATS_FORMAT::CSV)
+	{
+		fout << "name,x,count" << endl;
+		fout << "total,," << total << endl;
+		fout << "illegal,," << illegal << endl;
+		fout << "whiteCheckmates,," << whiteCheckmates << endl;
+		fout << "blackCheckmates,," << blackCheckmates << endl;
+		fout << "whiteKnownMates,," << whiteKnownMates << endl;
+		fout << "blackKnownMates,," << blackKnownMates << endl;
+		for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+			fout << "insufficientMaterial," << i << "," << insufficientMaterial[i] << endl;
+		for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+			fout << "stalemate," << i << "," << stalemate[i] << endl;
+		fout << "unknown,," << unknown << endl;
+		fout << "unforceable,," << unforceable << endl;
+		for (int x = 1; x <= highestX; x++)
+			fout << "mateInX," << x << "," << mateInX[x] << endl;
+		for (int x = 1; x <= highestX; x++)
+			fout << "responseMateInX," << x << "," << responseMateInX[x] << endl;
+		return (bool)fout;
+	}
+
+	fout << "{ \"signature\": \"" << signature << "\", \"total\": " << total << ", \"illegal\": " << illegal
+		<< ",\n  \"whiteCheckmates\": " << whiteCheckmates << ", \"blackCheckmates\": " << blackCheckmates
+		<< ", \"whiteKnownMates\": " << whiteKnownMates << ", \"blackKnownMates\": " << blackKnownMates
+		<< ",\n  \"insufficientMaterial\": [";
+	for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+		fout << (i ? ", " : "") << insufficientMaterial[i];
+	fout << "], \"stalemate\": [";
+	for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+		fout << (i ? ", " : "") << stalemate[i];
+	fout << "], \"unknown\": " << unknown << ", \"unforceable\": " << unforceable << ",\n  \"mateInX\": [";
+	for (int x = 0; x <= highestX; x++)
+		fout << (x ? ", " : "") << mateInX[x];
+	fout << "],\n  \"responseMateInX\": [";
+	for (int x = 0; x <= highestX; x++)
+		fout << (x ? ", " : "") << responseMateInX[x];
+	fout << "] }" << endl;
+	return (bool)fout;
+}
+
+void TABLE_STATS::WriteFooter(std::ostream& out) const
+{
+	vector<long long> values = { total, illegal, whiteCheckmates, blackCheckmates, whiteKnownMates, blackKnownMates };
+	values.insert(values.end(), insufficientMaterial, insufficientMaterial + STATS_IN_X_COUNTS);
+	values.insert(values.end(), stalemate, stalemate + STATS_IN_X_COUNTS);
+	values.push_back(unknown);
+	values.push_back(unforceable);
+	int highestX = GetHighestX();
+	values.push_back(highestX);
+	values.insert(values.end(), mateInX.begin(), mateInX.begin() + highestX + 1);
+	values.insert(values.end(), responseMateInX.begin(), responseMateInX.begin() + highestX + 1);
+	long long count = values.size();
+	out.write((const char*)values.data(), count * sizeof(long long));
+	out.write((const char*)&count, sizeof(count));
+	out.write(STATS_FOOTER_MAGIC, 8);
+}
+
+bool TABLE_STATS::ReadFooter(std::istream& in, long long positions, long long size)
+{
+	const int fixedCount = 6 + 2 * STATS_IN_X_COUNTS + 3;
+	in.clear();
+	if (size < positions + (long long)(sizeof(long long) + 8))
+		return false;
+	long long count = 0;
+	char magic[8];
+	in.seekg(size - sizeof(long long) - 8);
+	in.read((char*)&count, sizeof(count));
+	in.read(magic, 8);
+	if (!in || memcmp(magic, STATS_FOOTER_MAGIC, 8) != 0 || count < fixedCount + 2 ||
+		positions + (count + 1) * (long long)sizeof(long long) + 8 != size)
+		return false;
+
+	vector<long long> values(count);
+	in.seekg(positions);
+	in.read((char*)values.data(), count * sizeof(long long));
+	long long highestX = values[fixedCount - 1];
+	if (!in || highestX < 1 || fixedCount + 2 * (highestX + 1) != count)
+		return false;
+
+	Clear();
+	int v = 0;
+	total = values[v++];
+	illegal = values[v++];
+	whiteCheckmates = values[v++];
+	blackCheckmates = values[v++];
+	whiteKnownMates = values[v++];
+	blackKnownMates = values[v++];
+	for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+		insufficientMaterial[i] = values[v++];
+	for (int i = 0; i < STATS_IN_X_COUNTS; i++)
+		stalemate[i] = values[v++];
+	unknown = values[v++];
+	unforceable = values[v++];
+	v++; // highestX
+	mateInX.assign(max((long long)POSITIVE_OVERFLOW, highestX + 1), 0);
+	responseMateInX.assign(mateInX.size(), 0);
+	for (int x = 0; x <= highestX; x++)
+		mateInX[x] = values[v++];
+	for (int x = 0; x <= highestX; x++)
+		responseMateInX[x] = values[v++];
+	return true;
+}
+
+// Adds position p to stats, the same way for B and S as for a combined table.
+void Checkmate::CountPosition(int p, TABLE_STATS& stats)
+{
+	bool whiteToMove = GetTurnFromPosition(p) == PIECE_COLOR::WHITE;
+	stats.total++;
+
+	int mateCount = GetMovesToCheckmateCount(p);
+	unsigned char S = GetStatus(p);
+
+	if (!IsLegalPosition(p))
+		stats.illegal++;
+	else if (S & INSUFFICIENT_MATERIAL)
+		stats.insufficientMaterial[min(abs(mateCount), STATS_IN_X_COUNTS - 1)]++;
+	else if (S & IN_STALE_MATE)
+		stats.stalemate[min(abs(mateCount), STATS_IN_X_COUNTS - 1)]++;
+	else if (mateCount == UNKNOWN)
+		stats.unknown++;
+	else if (mateCount == UNFORCEABLE)
+		stats.unforceable++;
+	else
+	{
+		if (IsOverflow(mateCount))
+			mateCount = GetFullMovesToCheckmateCount(p);
+		if (mateCount > 0)
+			stats.whiteKnownMates++;
+		else if (mateCount < 0)
+			stats.blackKnownMates++;
+		if (mateCount != 0)
+			stats.AddMate(abs(mateCount), whiteToMove);
+		else if (whiteToMove)
+			stats.whiteCheckmates++;
+		else
+			stats.blackCheckmates++;
+	}
+}
+
+TABLE_STATS Checkmate::GatherStatistics()
+{
+	int threads = mStatsThreads > 0 ? mStatsThreads : (int)thread::hardware_concurrency();
+	threads = (int)max(1LL, min((long long)threads, mTotalPositions));
+
+	vector<TABLE_STATS> partial(threads);
+	vector<thread> workers;
+	for (int t = 0; t < threads; t++)
+	{
+		int begin = (int)((long long)mTotalPositions * t / threads);
+		int end = (int)((long long)mTotalPositions * (t + 1) / threads);
+		workers.push_back(thread([this, begin, end, &partial, t]()
+		{
+			for (int p = begin; p < end; p++)
+				CountPosition(p, partial[t]);
+		}));
+	}
+	for (int t = 0; t < threads; t++)
+		workers[t].join();
+
+	TABLE_STATS stats;
+	for (int t = 0; t < threads; t++)
+		stats.Add(partial[t]);
+	return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+// Counts of each kind of position in a table, what PrintEvaluation prints. Gathered by
+// Checkmate::GatherStatistics with one TABLE_STATS per thread, added together at the end.
+// Also written as <name>.stats.json, or <name>.stats.csv with SetStatsFormat(STATS_FORMAT::CSV):
+//		{ "signature": "WQ", "total": 532480, "illegal": 202720, ...,
+//		  "mateInX": [0, 2940, ...], "responseMateInX": [0, 1476, ...] }
+// or one "name,x,count" line for each count, x only for the ones by moves.
+// mateInX and responseMateInX are as long as the longest mate, overflows included.
+//
+// Made tables are counted as SwitchMovecountValues makes their values final, and the counts are
+// saved at the end of the combined table, after the positions:
+//		long long counts[], in the order of TABLE_STATS below, then highestX, then mateInX and
+//			responseMateInX from 0 to highestX
+//		long long count, how many long longs came before
+//		STATS_FOOTER_MAGIC
+// Readers that only read the positions don't see it.
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+enum class STATS_FORMAT { JSON, CSV };
+
+// Positions are counted in each of the insufficient material and stalemate counts by how many
+// moves away they are: now, in 1, in 2, and in 3 or more.
+const int STATS_IN_X_COUNTS = 4;
+
+const char STATS_FOOTER_MAGIC[9] = "STATS001";
+
+struct TABLE_STATS
+{
+	long long total;
+	long long illegal;
+	long long whiteCheckmates; // White to move and checkmated
+	long long blackCheckmates;
+	long long whiteKnownMates; // White wins
+	long long blackKnownMates;
+	long long insufficientMaterial[STATS_IN_X_COUNTS];
+	long long stalemate[STATS_IN_X_COUNTS];
+	long long unknown;
+	long long unforceable;
+	std::vector<long long> mateInX; // [x], White to move, either side winning in x
+	std::vector<long long> responseMateInX; // [x], Black to move
+
+	TABLE_STATS();
+	void Clear();
+	void Add(const TABLE_STATS& other);
+	void AddMate(int x, bool whiteToMove); // x > 0
+	int GetHighestX() const; // at least 1, like PrintEvaluation always showed
+
+	void Print() const;
+	bool Write(const std::string& filename, const std::string& signature, STATS_FORMAT format) const;
+	void WriteFooter(std::ostream& out) const;
+	// Reads the footer between positions bytes and size bytes into in. Returns false, and leaves
+	// the stats alone, if there is none.
+	bool ReadFooter(std::istream& in, long long positions, long long size);
+};
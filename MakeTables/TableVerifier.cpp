@@ -0,0 +1,336 @@
+/*
+Table verification.
+
+Checks that B agrees with itself, position by position, the way the solver passes define it,
+without using the legal moves cache or anything the passes kept. For each legal position,
+with n its full move count, and the successors made again with GenerateSuccessors:
+	The side to move wins in n: some successor is checkmate (n = 1) or a loss in n - 1 for the
+		side then to move, and no successor is a faster win.
+	The side to move loses in n: there is a move, and every successor is a win in n or less for
+		the other side, and some successor is a win in exactly n.
+	A draw: no successor wins for the side to move, and not every successor loses.
+	Checkmate (0): no successors. No successors: checkmate or a draw.
+When the table has a DTZ file, Z is checked the same way, with n its full zeroing count and the
+winner from B:
+	The winner to move zeroes in n: n is 1 if a capture or pawn move keeps the win, and otherwise
+		one more than the fewest of the successors that keep the win.
+	The loser to move zeroes in n: n is the most of the successors it can reach without zeroing,
+		or 0 if every move zeroes.
+	Draws and illegal positions have no count.
+Positions with a pawn on its promotion row are skipped, because AssignPawnPromotions copied them
+from the promoted table.
+
+Only B, S (or the combined table), Z and the overflows are read, so the threads don't need to share
+anything else. A table made by a faster or different solver can be checked the same way.
+*/
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+using namespace std;
+#include "CheckmateGeneral.h"
+#include "TableVerifier.h"
+#include "BuildScheduler.h"
+
+struct VERIFY_RESULT
+{
+	long long counts[TABLE_VIOLATION_KINDS];
+	long long checked;
+	long long skipped; // promotion positions
+	vector< pair<int, TABLE_VIOLATION> > kept; // the first VERIFY_MAX_KEPT
+};
+
+static bool IsDraw(char value)
+{
+	return value == UNFORCEABLE || value == STALEMATE_DRAW || value == INSUFFICIENT_MATERIAL_DRAW;
+}
+
+// 1 when White wins, -1 when Black does, and 0 for draws and illegal positions.
+// moverSign is 1 when it is White's turn in the position B is for.
+static int WinnerSign(char value, int moverSign)
+{
+	if (value == ILLEGAL || value == UNKNOWN || IsDraw(value))
+		return 0;
+	if (value == 0) // the side to move is mated
+		return -moverSign;
+	return (value > 0) ? 1 : -1;
+}
+
+static bool HasZeroingCount(char zero)
+{
+	return zero != UNKNOWN && zero != ILLEGAL && !IsDraw(zero);
+}
+
+bool Checkmate::IsPromotionPosition(const int positions[])
+{
+	for (int pieceIndex = 2; pieceIndex < NUM_PIECES; pieceIndex++)
+	{
+		int position = positions[pieceIndex + 1];
+		if (position == DEAD_POSITION)
+			continue;
+		if (mPieces[pieceIndex] == PIECE_TYPES::WHITE_PAWN && position / 8 == 7)
+			return true;
+		if (mPieces[pieceIndex] == PIECE_TYPES::BLACK_PAWN && position / 8 == 0)
+			return true;
+	}
+	return false;
+}
+
+TABLE_VIOLATION Checkmate::VerifyPosition(int p)
+{
+	char value = B[p];
+	bool legal = (S != NULL) ? IsLegalPosition(p) : (value != ILLEGAL);
+	if (legal == (value == ILLEGAL))
+		return TABLE_VIOLATION::ILLEGAL_MISMATCH;
+	if (!legal)
+		return TABLE_VIOLATION::NONE;
+	if (value == UNKNOWN)
+		return TABLE_VIOLATION::UNKNOWN_LEFT;
+
+	int positions[POSITION_ARRAY_SIZE];
+	FromIndex(p, positions);
+	int moverSign = ((PIECE_COLOR)positions[0] == PIECE_COLOR::WHITE) ? 1 : -1; // B is positive when White wins
+	unsigned char status = GetStatus(p);
+	unsigned int successors[MAX_SUCCESSORS];
+	int count = GenerateSuccessors(p, successors);
+
+	if (count == 0)
+	{
+		if (value != 0 && !IsDraw(value))
+			return TABLE_VIOLATION::NO_MOVES_NOT_ENDED;
+		return TABLE_VIOLATION::NONE;
+	}
+	if (value == 0 || (status & IN_CHECK_MATE))
+		return TABLE_VIOLATION::MATE_WITH_MOVES;
+	if (status & IN_STALE_MATE)
+		return TABLE_VIOLATION::STALEMATE_WITH_MOVES;
+
+	bool draw = IsDraw(value);
+	int n = draw ? 0 : abs(GetFullMovesToCheckmateCount(p));
+	bool wins = !draw && value * moverSign > 0;
+	bool loses = !draw && !wins;
+	bool stepFound = false; // a win's successor at n - 1, or a loss's at n
+	bool allLose = true; // every successor is a win for the other side
+	for (int m = 0; m < count; m++)
+	{
+		int next = successors[m];
+		char nextValue = B[next];
+		if (nextValue == ILLEGAL || nextValue == UNKNOWN || IsDraw(nextValue))
+		{
+			allLose = false;
+			if (loses)
+				return TABLE_VIOLATION::LOSS_WITH_ESCAPE;
+			continue;
+		}
+		if (nextValue == 0) // the other side is mated
+		{
+			allLose = false;
+			if (draw)
+				return TABLE_VIOLATION::DRAW_WITH_WIN;
+			if (loses)
+				return TABLE_VIOLATION::LOSS_WITH_ESCAPE;
+			if (n > 1)
+				return TABLE_VIOLATION::WIN_NOT_SHORTEST;
+			stepFound = true;
+			continue;
+		}
+		int nextCount = GetFullMovesToCheckmateCount(next);
+		if (nextCount * moverSign > 0) // the side to move here wins after this move
+		{
+			allLose = false;
+			if (draw)
+				return TABLE_VIOLATION::DRAW_WITH_WIN;
+			if (loses)
+				return TABLE_VIOLATION::LOSS_WITH_ESCAPE;
+			if (abs(nextCount) < n - 1)
+				return TABLE_VIOLATION::WIN_NOT_SHORTEST;
+			if (abs(nextCount) == n - 1)
+				stepFound = true;
+		}
+		else if (loses)
+		{
+			if (abs(nextCount) > n)
+				return TABLE_VIOLATION::LOSS_WITH_ESCAPE;
+			if (abs(nextCount) == n)
+				stepFound = true;
+		}
+	}
+
+	if (draw)
+		return allLose ? TABLE_VIOLATION::DRAW_ALL_LOST : TABLE_VIOLATION::NONE;
+	if (!stepFound)
+		return wins ? TABLE_VIOLATION::WIN_WITHOUT_STEP : TABLE_VIOLATION::LOSS_NOT_LONGEST;
+	return TABLE_VIOLATION::NONE;
+}
+
+TABLE_VIOLATION Checkmate::VerifyZeroing(int p)
+{
+	char value = B[p];
+	char zero = Z[p];
+	if (value == ILLEGAL || IsDraw(value))
+		return (zero == ((value == ILLEGAL) ? ILLEGAL : UNFORCEABLE)) ? TABLE_VIOLATION::NONE : TABLE_VIOLATION::ZEROING_ON_DRAW;
+	if (!HasZeroingCount(zero))
+		return TABLE_VIOLATION::ZEROING_UNKNOWN;
+
+	int positions[POSITION_ARRAY_SIZE];
+	FromIndex(p, positions);
+	int moverSign = ((PIECE_COLOR)positions[0] == PIECE_COLOR::WHITE) ? 1 : -1;
+	int winner = WinnerSign(value, moverSign);
+	int n = GetFullMovesToZeroingCount(p);
+	if (n * winner < 0) // Z is positive when White wins, like B
+		return TABLE_VIOLATION::ZEROING_WRONG_SIDE;
+	n = abs(n);
+
+	unsigned int successors[MAX_SUCCESSORS];
+	int count = GenerateSuccessors(p, successors);
+	if (winner == moverSign)
+	{
+		int fewest = 0; // none yet
+		for (int m = 0; m < count; m++)
+		{
+			int next = successors[m];
+			if (WinnerSign(B[next], -moverSign) != winner)
+				continue; // gives away the win
+			int steps;
+			if (IsZeroingMove(positions, next))
+				steps = 1;
+			else if (HasZeroingCount(Z[next]))
+				steps = abs(GetFullMovesToZeroingCount(next)) + 1;
+			else
+				continue;
+			if (fewest == 0 || steps < fewest)
+				fewest = steps;
+		}
+		if (fewest != 0 && fewest < n)
+			return TABLE_VIOLATION::ZEROING_NOT_SHORTEST;
+		if (fewest != n)
+			return TABLE_VIOLATION::ZEROING_WITHOUT_STEP;
+		return TABLE_VIOLATION::NONE;
+	}
+
+	int most = 0;
+	for (int m = 0; m < count; m++)
+	{
+		int next = successors[m];
+		if (IsZeroingMove(positions, next))
+			continue; // starts the count again
+		if (!HasZeroingCount(Z[next]))
+			return TABLE_VIOLATION::ZEROING_LOSS_LONGER; // never has to zero this way
+		most = max(most, abs(GetFullMovesToZeroingCount(next)));
+	}
+	if (most > n)
+		return TABLE_VIOLATION::ZEROING_LOSS_LONGER;
+	if (most < n)
+		return TABLE_VIOLATION::ZEROING_LOSS_NOT_LONGEST;
+	return TABLE_VIOLATION::NONE;
+}
+
+bool Checkmate::VerifyTable(int threads)
+{
+	if (threads < 1)
+		threads = 1;
+	cout << "\nVerifying " << GetSignature() << " on " << threads << " threads..." << endl;
+	time_t t1 = time(0);
+
+	vector<VERIFY_RESULT> results(threads);
+	vector<thread> workers;
+	for (int t = 0; t < threads; t++)
+	{
+		int begin = (int)(mTotalPositions * t / threads);
+		int end = (int)(mTotalPositions * (t + 1) / threads);
+		workers.push_back(thread([this, begin, end, &results, t]()
+		{
+			VERIFY_RESULT& result = results[t];
+			fill(result.counts, result.counts + TABLE_VIOLATION_KINDS, 0);
+			result.checked = 0;
+			result.skipped = 0;
+			for (int p = begin; p < end; p++)
+			{
+				int positions[POSITION_ARRAY_SIZE];
+				FromIndex(p, positions);
+				if (IsPromotionPosition(positions))
+				{
+					result.skipped++;
+					continue;
+				}
+				result.checked++;
+				TABLE_VIOLATION violation = VerifyPosition(p);
+				if (violation == TABLE_VIOLATION::NONE && Z != NULL)
+					violation = VerifyZeroing(p);
+				if (violation == TABLE_VIOLATION::NONE)
+					continue;
+				result.counts[(int)violation]++;
+				if (result.kept.size() < VERIFY_MAX_KEPT)
+					result.kept.push_back(make_pair(p, violation));
+			}
+		}));
+	}
+	for (int t = 0; t < threads; t++)
+		workers[t].join();
+
+	long long checked = 0;
+	long long skipped = 0;
+	long long counts[TABLE_VIOLATION_KINDS] = { 0 };
+	vector< pair<int, TABLE_VIOLATION> > kept;
+	for (int t = 0; t < threads; t++)
+	{
+		checked += results[t].checked;
+		skipped += results[t].skipped;
+		for (int v = 0; v < TABLE_VIOLATION_KINDS; v++)
+			counts[v] += results[t].counts[v];
+		kept.insert(kept.end(), results[t].kept.begin(), results[t].kept.end());
+	}
+	long long total = 0;
+	for (int v = 0; v < TABLE_VIOLATION_KINDS; v++)
+		total += counts[v];
+
+	cout << "Checked " << checked << " positions, skipped " << skipped << " promotion positions, in "
+		<< (double)(time(0) - t1) << " seconds." << endl;
+	if (total == 0)
+	{
+		cout << GetSignature() << " is consistent." << endl;
+		return true;
+	}
+
+	cout << "Error. " << total << " positions don't agree with their successors:" << endl;
+	for (int v = 1; v < TABLE_VIOLATION_KINDS; v++)
+		if (counts[v])
+			cout << "  " << gTableViolationNames[v] << ": " << counts[v] << endl;
+	for (unsigned int k = 0; k < kept.size() && k < VERIFY_MAX_PRINTED; k++)
+		cout << "  position " << kept[k].first << " (B = " << (int)B[kept[k].first] << "): "
+			<< gTableViolationNames[(int)kept[k].second] << endl;
+
+	string filename = MakeFilenameFromPieces(mPieces) + ".verify.txt";
+	ofstream fout(filename);
+	for (unsigned int k = 0; k < kept.size(); k++)
+		fout << kept[k].first << " " << (int)B[kept[k].first] << " " << gTableViolationNames[(int)kept[k].second] << endl;
+	if (fout)
+		cout << "All " << kept.size() << " kept positions are in " << filename << endl;
+	return false;
+}
+
+bool VerifyTables(const std::vector<std::string>& signatures, int threads)
+{
+	bool consistent = true;
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		vector< PIECE_TYPES> pieces;
+		if (!BuildScheduler::PiecesFromSignature(signatures[i], pieces))
+		{
+			cout << "Error. " << signatures[i] << " is not a set of " << NUM_PIECES << " pieces." << endl;
+			return false;
+		}
+		Checkmate checkmate;
+		string filename = checkmate.MakeFilenameFromPieces(pieces);
+		if (!ifstream(filename + ".table.bin") && !checkmate.CombinedTableExists(pieces))
+		{
+			cout << "Error. There is no " << signatures[i] << " table to verify." << endl;
+			consistent = false;
+			continue;
+		}
+		checkmate.Initialize(pieces, true);
+		if (!checkmate.VerifyTable(threads))
+			consistent = false;
+	}
+	return consistent;
+}
@@ -0,0 +1,13 @@
+#pragma once
+// Checks tables on disk, for example after a build, or after changing the solver:
+//		MakeTables -verify WBWN WQBR -threads=8
+// Each table is loaded, and every position is checked against its successors, made again from
+// the rules and not from anything the solver kept (see Checkmate::VerifyTable in TableVerifier.cpp).
+// Its DTZ table is checked too, when it has one.
+// Positions that don't agree are printed and written to <name>.verify.txt.
+
+#include <string>
+#include <vector>
+
+// Returns false if any table is missing or not consistent.
+bool VerifyTables(const std::vector<std::string>& signatures, int threads);
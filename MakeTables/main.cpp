@@ -1,9 +1,218 @@
 #include <iostream>
+#include <string>
+#include <thread>
 #include "..\\MakeTables\\CheckmateGeneral.h"
+#include "..\\MakeTables\\BuildScheduler.h"
+#include "..\\MakeTables\\Benchmarks.h"
+#include "..\\MakeTables\\TableVerifier.h"
+#include "..\\MakeTables\\Predecessors.h"
+#include "..\\MakeTables\\GoldenTables.h"
+#include "..\\MakeTables\\TableDiff.h"
 Checkmate gCheckmate; // a "smart" checkmate object
 
-int main()
+// Loads each table and prints its statistics, and writes them to <name>.stats.json or .csv.
+static bool PrintTableStatistics(const std::vector<std::string>& signatures, int threads, STATS_FORMAT format)
 {
+	for (unsigned int i = 0; i < signatures.size(); i++)
+	{
+		std::vector< PIECE_TYPES> pieces;
+		if (!BuildScheduler::PiecesFromSignature(signatures[i], pieces))
+		{
+			std::cout << "Error. " << signatures[i] << " is not a set of " << NUM_PIECES << " pieces." << std::endl;
+			return false;
+		}
+		Checkmate checkmate;
+		checkmate.SetStatsThreads(threads);
+		checkmate.SetStatsFormat(format);
+		checkmate.Initialize(pieces, true, true);
+	}
+	return true;
+}
+
+// With no arguments, makes the one table set up below.
+// Otherwise makes a whole family of tables, for example:
+//		MakeTables WBWN WPBP -memory=16 -threads=4
+//		MakeTables all
+//		MakeTables WBWN -processes=8
+//		MakeTables WQWRBR -outofcore=D:\scratch -resident=4
+// -memory is in gigabytes. -rebuild makes every table, even ones that are up to date.
+// -processes splits each table's solver passes among that many worker processes.
+// Each table is made the fastest way that fits in -memory (default all of it, see MemoryPlanner.h).
+// -outofcore lets a table that doesn't fit keep its big arrays in scratch files in that
+// directory, using about -resident gigabytes of memory (default 2) for the legal moves cache.
+// B, S and Z still have to fit in memory.
+// -hugepages=transparent or -hugepages=explicit asks for huge pages for the big arrays.
+// -numa=interleave spreads them over the NUMA nodes. -numa=partitioned puts each -processes
+// worker's part on its own node.
+// -layout=interleaved makes the tables with the turn last in each index, next to its successors
+// (see INDEX_LAYOUT in CheckmateGeneral.h). -layout=major is the default.
+// -order=tiled goes through each solver pass a king pair at a time, instead of in index order
+// (see SOLVER_ORDER in CheckmateGeneral.h).
+// -prefetch has the solver passes prefetch successors (see SOLVER_PREFETCH_DISTANCE).
+// -planes has IsLegalPosition read a bit plane of the illegal bits instead of S (see StatusPlanes.h).
+// -legacyfiles saves each table's .table.bin and .status.bin too, next to its .combined.bin and .dtz.bin.
+// -progress shows how far along each long phase is, and about how long it has left.
+// Every table also gets a <name>.report.json with the time each phase took (see BuildReport.h).
+// -perf adds the hardware performance counters of each phase to it, where they can be read.
+// -trace=build.json writes a timeline of every table made, for chrome://tracing or ui.perfetto.dev.
+// -nocache makes successors as they are needed instead of keeping the legal moves cache.
+// That uses the slow move generator for every successor read, so it is 3.5 to 5 times slower.
+// -benchmark=successors times each table with and without the legal moves cache (see Benchmarks.h).
+// -benchmark=prefetch makes each table with and without successor prefetching, the same way.
+// -benchmark=planes makes each table with and without the illegal bit plane, the same way.
+// -benchmark=order makes each table with each SOLVER_ORDER, times their solver passes, and checks they agree.
+// -benchmark=layouts makes each table with each INDEX_LAYOUT, times their solver passes, and checks they agree.
+// -benchmark=kernels times the generator's small routines, like FromIndex and IsMateInXRange, by themselves.
+// -verify checks that every position of each table agrees with its successors (see TableVerifier.h).
+// -unmoves checks that each table's predecessors, made going backward, agree with its successors
+// (see Predecessors.h).
+// -benchmark=matrix makes a fixed set of tables and compares them with -baseline=matrix.benchmark.txt.
+// -golden makes the checked in 3 piece tables every way it can and compares them (see GoldenTables.h).
+// Built with NUM_PIECES = 4 it does the same for the two pawn table and the tables it needs.
+// -golden=update writes new golden.txt (or golden4.txt) hashes.
+// -diff a.table.bin b.table.bin compares two table files, with -status their status files too
+// (made with -legacyfiles),
+// and prints the first -first=N positions that differ (see TableDiff.h).
+// -stats prints each table's statistics with -threads threads, and writes them to <name>.stats.json,
+// or <name>.stats.csv with -csv (see TableStats.h).
+int main(int argc, char* argv[])
+{
+	if (argc > 1)
+	{
+		BuildScheduler scheduler;
+		std::string outOfCoreDirectory;
+		double residentGigabytes = 2;
+		std::string benchmark;
+		std::string baselineFile;
+		bool verify = false;
+		bool unmoves = false;
+		bool diff = false;
+		bool diffStatus = false;
+		bool stats = false;
+		STATS_FORMAT statsFormat = STATS_FORMAT::JSON;
+		int firstPositions = DIFF_FIRST_POSITIONS;
+		int threads = (int)std::thread::hardware_concurrency();
+		std::vector<std::string> signatures;
+		for (int a = 1; a < argc; a++)
+		{
+			std::string arg = argv[a];
+			if (arg == "-golden" || arg == "-golden=update")
+				return RunGoldenTables(arg == "-golden=update") ? 0 : 1;
+			if (arg[0] != '-' && arg != "all")
+				signatures.push_back(arg);
+			if (arg.compare(0, 11, "-benchmark=") == 0)
+				benchmark = arg.substr(11);
+			else if (arg.compare(0, 11, "-outofcore=") == 0)
+				outOfCoreDirectory = arg.substr(11);
+			else if (arg.compare(0, 10, "-resident=") == 0)
+				residentGigabytes = std::stod(arg.substr(10));
+			else if (arg.compare(0, 10, "-baseline=") == 0)
+				baselineFile = arg.substr(10);
+			else if (arg == "-verify")
+				verify = true;
+			else if (arg == "-unmoves")
+				unmoves = true;
+			else if (arg == "-diff")
+				diff = true;
+			else if (arg == "-status")
+				diffStatus = true;
+			else if (arg == "-stats")
+				stats = true;
+			else if (arg == "-csv")
+				statsFormat = STATS_FORMAT::CSV;
+			else if (arg.compare(0, 7, "-first=") == 0)
+				firstPositions = std::stoi(arg.substr(7));
+			else if (arg.compare(0, 9, "-threads=") == 0)
+				threads = std::stoi(arg.substr(9));
+			else if (arg == "-layout=interleaved")
+				scheduler.SetIndexLayout(INDEX_LAYOUT::TURN_INTERLEAVED);
+			else if (arg == "-layout=major")
+				scheduler.SetIndexLayout(INDEX_LAYOUT::TURN_MAJOR);
+		}
+		if (diff)
+		{
+			if (signatures.size() != 2)
+			{
+				std::cout << "Error. -diff needs two table files." << std::endl;
+				return 1;
+			}
+			return DiffTables(signatures[0], signatures[1], diffStatus, firstPositions) ? 0 : 1;
+		}
+		if (stats)
+			return PrintTableStatistics(signatures, threads, statsFormat) ? 0 : 1;
+		if (verify)
+			return VerifyTables(signatures, threads) ? 0 : 1;
+		if (unmoves)
+			return CheckPredecessorTables(signatures, threads) ? 0 : 1;
+		if (benchmark == "successors")
+			return BenchmarkSuccessorModes(signatures) ? 0 : 1;
+		else if (benchmark == "kernels")
+			return BenchmarkKernels(signatures) ? 0 : 1;
+		else if (benchmark == "prefetch")
+			return BenchmarkSolverPrefetch(signatures) ? 0 : 1;
+		else if (benchmark == "planes")
+			return BenchmarkStatusPlanes(signatures) ? 0 : 1;
+		else if (benchmark == "order")
+			return BenchmarkSolverOrders(signatures) ? 0 : 1;
+		else if (benchmark == "layouts")
+			return BenchmarkIndexLayouts(signatures) ? 0 : 1;
+		else if (benchmark == "matrix")
+			return BenchmarkBuildMatrix(baselineFile) ? 0 : 1;
+		else if (!benchmark.empty())
+		{
+			std::cout << "Error. Unknown benchmark " << benchmark << std::endl;
+			return 1;
+		}
+		if (!outOfCoreDirectory.empty())
+			scheduler.SetOutOfCore(outOfCoreDirectory, (long long)(residentGigabytes * 1024 * 1024 * 1024));
+
+		for (int a = 1; a < argc; a++)
+		{
+			std::string arg = argv[a];
+			if (arg.compare(0, 11, "-outofcore=") == 0 || arg.compare(0, 10, "-resident=") == 0)
+				continue; // already done
+			else if (arg == "all")
+				scheduler.AddAllSignatures();
+			else if (arg.compare(0, 8, "-memory=") == 0)
+				scheduler.SetMemoryBudget((long long)(std::stod(arg.substr(8)) * 1024 * 1024 * 1024));
+			else if (arg.compare(0, 9, "-threads=") == 0)
+				scheduler.SetMaxThreads(std::stoi(arg.substr(9)));
+			else if (arg.compare(0, 11, "-processes=") == 0)
+				scheduler.SetPartitionWorkers(std::stoi(arg.substr(11)));
+			else if (arg == "-rebuild")
+				scheduler.SetForceRebuild(true);
+			else if (arg == "-progress")
+				scheduler.SetShowProgress(true);
+			else if (arg == "-perf")
+				scheduler.SetPerfCounters(true);
+			else if (arg.compare(0, 7, "-trace=") == 0)
+				scheduler.SetTraceFile(arg.substr(7));
+			else if (arg == "-nocache")
+				scheduler.SetOnTheFlySuccessors(true);
+			else if (arg == "-hugepages=transparent")
+				scheduler.SetHugePages(HUGE_PAGES::TRANSPARENT);
+			else if (arg == "-hugepages=explicit")
+				scheduler.SetHugePages(HUGE_PAGES::EXPLICIT);
+			else if (arg == "-numa=interleave")
+				scheduler.SetNumaPolicy(NUMA_POLICY::INTERLEAVE);
+			else if (arg == "-numa=partitioned")
+				scheduler.SetNumaPolicy(NUMA_POLICY::PARTITIONED);
+			else if (arg.compare(0, 8, "-layout=") == 0)
+				continue; // already done
+			else if (arg == "-order=tiled")
+				scheduler.SetSolverOrder(SOLVER_ORDER::KING_TILED);
+			else if (arg == "-prefetch")
+				scheduler.SetSolverPrefetch(true);
+			else if (arg == "-planes")
+				scheduler.SetStatusPlanes(true);
+			else if (arg == "-legacyfiles")
+				scheduler.SetLegacyTableFiles(true);
+			else if (!scheduler.AddSignature(arg))
+				return 1;
+		}
+		return scheduler.Run() ? 0 : 1;
+	}
+
 	bool loadData = false;
 	std::vector< PIECE_TYPES> pieces;
 	pieces.push_back(PIECE_TYPES::BLACK_KING);